@@ -18,6 +18,7 @@
 
 #include <QApplication>
 #include <QCommandLineParser>
+#include <QGeoView/QGVTileStore.h>
 
 #include "mainwindow.h"
 
@@ -31,6 +32,13 @@ int main(int argc, char* argv[])
     parser.addVersionOption();
     parser.process(app);
 
+    /*
+     * Persistent tile store is shared by all "online" layers and must outlive them,
+     * so it is created before the main window.
+     */
+    QGVTileStore tileStore("tileStore");
+    QGV::setTileStore(&tileStore);
+
     MainWindow window;
     window.show();
     return app.exec();
@@ -111,7 +111,7 @@ MainWindow::~MainWindow()
 void MainWindow::init()
 {
     /*
-     * All "online" items required instance of QNetworkAccessManager.
+     * All "online" items (except of tiles) required instance of QNetworkAccessManager.
      * Also it is recommended to use QNetworkCache for this manager to reduce
      * network load and speed-up download.
      */
@@ -122,6 +122,15 @@ void MainWindow::init()
     mManager->setCache(mCache);
     QGV::setNetworkManager(mManager);
 
+    /*
+     * Tiles of "online" layers are downloaded by tile fetcher in its own thread,
+     * so it has own network cache.
+     */
+    QDir("tileCacheDir").removeRecursively();
+    mFetcher = new QGVTileFetcher(this);
+    mFetcher->setCacheDirectory("tileCacheDir");
+    QGV::setTileFetcher(mFetcher);
+
     mDemo = {
         new WidgetsDemo(ui->geoMap, this),   new BackgroundDemo(ui->geoMap, this), new MouseDemo(ui->geoMap, this),
         new ItemsDemo(ui->geoMap, this),     new FlagsDemo(ui->geoMap, this),      new CustomTiles(ui->geoMap, this),
@@ -22,6 +22,7 @@
 #include <QNetworkAccessManager>
 #include <QNetworkDiskCache>
 
+#include <QGeoView/QGVTileFetcher.h>
 #include <QGeoView/QGVWidgetCompass.h>
 #include <QGeoView/QGVWidgetScale.h>
 #include <QGeoView/QGVWidgetZoom.h>
@@ -54,6 +55,7 @@ private:
     Ui::MainWindow* ui;
     QNetworkAccessManager* mManager;
     QNetworkDiskCache* mCache;
+    QGVTileFetcher* mFetcher;
     DemoItem* mCurrentItem;
     QList<DemoItem*> mDemo;
 };
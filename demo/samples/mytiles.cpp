@@ -20,17 +20,10 @@
 #include "mytile.h"
 
 MyTiles::MyTiles(const QGV::GeoRect& activeRect, QColor color)
-    : mActiveGeoRect(activeRect)
-    , mColor(color)
+    : mColor(color)
 {
     setZValue(-1);
-}
-
-void MyTiles::onProjection(QGVMap* geoMap)
-{
-    QGVLayerTiles::onProjection(geoMap);
-    mActiveTileRect = QRect(QGV::GeoTilePos::geoToTilePos(minZoomlevel(), mActiveGeoRect.topLeft()).pos(),
-                            QGV::GeoTilePos::geoToTilePos(minZoomlevel(), mActiveGeoRect.bottomRight()).pos());
+    addCoverage(activeRect);
 }
 
 int MyTiles::minZoomlevel() const
@@ -45,10 +38,6 @@ int MyTiles::maxZoomlevel() const
 
 void MyTiles::request(const QGV::GeoTilePos& tilePos)
 {
-    auto tilePosParent = tilePos.parent(minZoomlevel()).pos();
-    if (!mActiveTileRect.contains(tilePosParent)) {
-        return;
-    }
     QGVDrawItem* tile = new MyTile(tilePos, mColor);
     tile->setOpacity(0.5);
     tile->setSelectable(false);
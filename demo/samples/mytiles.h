@@ -28,14 +28,11 @@ public:
     MyTiles(const QGV::GeoRect& activeRect, QColor color);
 
 private:
-    void onProjection(QGVMap* geoMap) override;
     int minZoomlevel() const override final;
     int maxZoomlevel() const override final;
     void request(const QGV::GeoTilePos& tilePos) override final;
     void cancel(const QGV::GeoTilePos& tilePos) override;
 
 private:
-    QGV::GeoRect mActiveGeoRect;
-    QRect mActiveTileRect;
     QColor mColor;
 };
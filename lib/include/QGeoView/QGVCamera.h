@@ -99,6 +99,8 @@ protected:
     virtual void onStart();
     virtual void onStop();
     virtual void onProgress(double progress, QGVCameraActions& target) = 0;
+    virtual QList<QGVCameraState> plannedStates() const;
+    QGVCameraState plannedState(double scale, const QPointF& projCenter) const;
 
     static double interpolateScale(double from, double to, double progress);
     static double interpolateAzimuth(double from, double to, double progress);
@@ -136,6 +138,7 @@ public:
 private:
     void onStart() override;
     void onProgress(double progress, QGVCameraActions& target) override;
+    QList<QGVCameraState> plannedStates() const override;
 
 private:
     double mFlyScale;
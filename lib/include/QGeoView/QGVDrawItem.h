@@ -38,6 +38,7 @@ public:
 
     void refresh();
     void repaint();
+    void repaint(const QRectF& projRect);
     void resetBoundary();
     QTransform effectiveTransform() const;
 
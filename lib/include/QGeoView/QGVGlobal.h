@@ -24,6 +24,9 @@
 #include <QPointF>
 #include <QRectF>
 
+class QGVTileFetcher;
+class QGVTileStore;
+
 #if defined(QGV_EXPORT)
 #define QGV_LIB_DECL Q_DECL_EXPORT
 #else
@@ -75,6 +78,7 @@ enum class ItemFlag : int
     SelectCustom = 0x20,
     Transformed = 0x40,
     Clickable = 0x80,
+    Uncached = 0x100,
 };
 Q_DECLARE_FLAGS(ItemFlags, ItemFlag)
 
@@ -154,7 +158,9 @@ public:
 
     GeoRect toGeoRect() const;
     QString toQuadKey() const;
+    quint64 toKey() const;
 
+    static GeoTilePos fromKey(quint64 key);
     static GeoTilePos geoToTilePos(int zoom, const GeoPos& geoPos);
 
 private:
@@ -164,6 +170,10 @@ private:
 
 QGV_LIB_DECL void setNetworkManager(QNetworkAccessManager* manager);
 QGV_LIB_DECL QNetworkAccessManager* getNetworkManager();
+QGV_LIB_DECL void setTileStore(QGVTileStore* store);
+QGV_LIB_DECL QGVTileStore* getTileStore();
+QGV_LIB_DECL void setTileFetcher(QGVTileFetcher* fetcher);
+QGV_LIB_DECL QGVTileFetcher* getTileFetcher();
 
 QGV_LIB_DECL QTransform createTransfrom(QPointF const& projAnchor, double scale, double azimuth);
 QGV_LIB_DECL QTransform createTransfromScale(QPointF const& projAnchor, double scale);
@@ -19,7 +19,10 @@
 #pragma once
 
 #include "QGVDrawItem.h"
+#include <QMap>
 #include <QNetworkReply>
+#include <QPixmap>
+#include <QVector>
 
 class QGV_LIB_DECL QGVImage : public QGVDrawItem
 {
@@ -27,16 +30,26 @@ class QGV_LIB_DECL QGVImage : public QGVDrawItem
 
 public:
     QGVImage();
+    ~QGVImage();
 
     void setGeometry(const QGV::GeoRect& geoRect);
     void setGeometry(const QGV::GeoPos& geoPos, const QSize& imageSize = QSize(), const QPoint& imageAnchor = QPoint());
 
     QImage getImage() const;
+    QByteArray getEncoded() const;
+    QSize getImageSize() const;
     bool isImage() const;
 
     void load(const QString& url);
     void loadImage(const QByteArray& rawData);
     void loadImage(const QImage& image);
+    void loadEncoded(const QByteArray& rawData);
+    void releaseImage();
+
+    void paint(QPainter* painter, const QRectF& projRect, const QGVCameraState& camera);
+
+Q_SIGNALS:
+    void imageChanged();
 
 protected:
     void onProjection(QGVMap* geoMap) override;
@@ -47,6 +60,13 @@ protected:
 private:
     void onReplyFinished();
     void calculateGeometry();
+    bool paintExact(QPainter* painter, const QRectF& projRect);
+    QImage mipImage(QPainter* painter, const QRectF& paintRect);
+    void requestMip(int level);
+    void resetMips();
+    void requestDecode();
+    void startDecode();
+    void cancelDecode();
 
 private:
     enum class GeometryType
@@ -63,5 +83,10 @@ private:
     QPointF mProjAnchor;
     QString mUrl;
     QImage mImage;
+    QByteArray mEncoded;
+    quint64 mDecodeTicket;
+    QPixmap mPixmap;
+    QVector<QImage> mMips;
+    QMap<int, quint64> mMipTickets;
     QScopedPointer<QNetworkReply> mReply;
 };
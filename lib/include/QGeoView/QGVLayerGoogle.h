@@ -27,7 +27,7 @@ class QGV_LIB_DECL QGVLayerGoogle : public QGVLayerTilesOnline
 public:
     explicit QGVLayerGoogle(QGV::TilesType type = QGV::TilesType::Schema,
                             QLocale locale = QLocale(),
-                            int serverNumber = 0);
+                            int serverNumber = -1);
 
     void setType(QGV::TilesType type);
     void setLocale(const QLocale& locale);
@@ -40,6 +40,8 @@ private:
     int minZoomlevel() const override;
     int maxZoomlevel() const override;
     QString tilePosToUrl(const QGV::GeoTilePos& tilePos) const override;
+    QString tilePosToMirrorUrl(const QGV::GeoTilePos& tilePos, int mirror) const override;
+    int countMirrors() const override;
 
 private:
     QGV::TilesType mType;
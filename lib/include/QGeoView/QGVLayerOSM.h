@@ -25,7 +25,7 @@ class QGV_LIB_DECL QGVLayerOSM : public QGVLayerTilesOnline
     Q_OBJECT
 
 public:
-    explicit QGVLayerOSM(int serverNumber = 0);
+    explicit QGVLayerOSM(int serverNumber = -1);
     explicit QGVLayerOSM(const QString& url);
 
     void setUrl(const QString& url);
@@ -35,7 +35,10 @@ private:
     int minZoomlevel() const override;
     int maxZoomlevel() const override;
     QString tilePosToUrl(const QGV::GeoTilePos& tilePos) const override;
+    QString tilePosToMirrorUrl(const QGV::GeoTilePos& tilePos, int mirror) const override;
+    int countMirrors() const override;
 
 private:
     QString mUrl;
+    QStringList mMirrors;
 };
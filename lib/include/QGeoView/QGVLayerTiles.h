@@ -19,8 +19,16 @@
 #pragma once
 
 #include "QGVLayer.h"
+#include "QGVTileCache.h"
+#include "QGVTileIndex.h"
+#include "QGVTileWorker.h"
 
+#include <QBitArray>
 #include <QElapsedTimer>
+#include <QTimer>
+
+class QGVLayerTilesComposite;
+class QGVLayerTilesPainter;
 
 class QGV_LIB_DECL QGVLayerTiles : public QGVLayer
 {
@@ -28,6 +36,36 @@ class QGV_LIB_DECL QGVLayerTiles : public QGVLayer
 
 public:
     QGVLayerTiles();
+    ~QGVLayerTiles();
+
+    QGVTileWorker* getTileWorker() const;
+    void setTileCache(const QSharedPointer<QGVTileCache>& cache);
+    QSharedPointer<QGVTileCache> getTileCache() const;
+    virtual QString getTileSource() const;
+    void setPrefetchTiles(int tiles);
+    int getPrefetchTiles() const;
+    void setOverzoom(bool enabled);
+    bool isOverzoom() const;
+    void setCoarseLevels(int levels);
+    int getCoarseLevels() const;
+    void addCoverage(const QGV::GeoRect& geoRect, int fromZoom = -1, int toZoom = -1);
+    void setNoDataMap(int zoom, const QBitArray& noData);
+    void clearCoverage();
+    bool isTileCovered(const QGV::GeoTilePos& tilePos) const;
+    void setBatchPaint(bool enabled);
+    bool isBatchPaint() const;
+    void setSnapToZoom(bool enabled);
+    bool isSnapToZoom() const;
+    void setSettleDelay(int msDelay);
+    int getSettleDelay() const;
+    void setSettleDeadline(int msDeadline);
+    int getSettleDeadline() const;
+    void setCancelGrace(int msGrace);
+    int getCancelGrace() const;
+    void setCompressedTiles(bool enabled);
+    bool isCompressedTiles() const;
+    void setTileTtl(int msTtl);
+    int getTileTtl() const;
 
 protected:
     void onProjection(QGVMap* geoMap) override;
@@ -35,26 +73,97 @@ protected:
     void onUpdate() override;
     void onClean() override;
     void onTile(const QGV::GeoTilePos& tilePos, QGVDrawItem* tileObj);
+    void onTileMissing(const QGV::GeoTilePos& tilePos, int msTimeout = -1);
+    void onTileValid(const QGV::GeoTilePos& tilePos);
+    void onTileRefresh(const QGV::GeoTilePos& tilePos, QGVDrawItem* tileObj);
 
     virtual int minZoomlevel() const = 0;
     virtual int maxZoomlevel() const = 0;
     virtual int scaleToZoom(double scale) const;
     virtual void request(const QGV::GeoTilePos& tilePos) = 0;
     virtual void cancel(const QGV::GeoTilePos& tilePos) = 0;
+    virtual bool isRequestInFlight(const QGV::GeoTilePos& tilePos) const;
+    virtual void revalidate(const QGV::GeoTilePos& tilePos);
+    virtual QGVDrawItem* createTile(const QGV::GeoTilePos& tilePos, const QImage& image);
+    QGVDrawItem* createEncodedTile(const QGV::GeoTilePos& tilePos, const QByteArray& rawImage);
+    bool isTileVisible(const QGV::GeoTilePos& tilePos) const;
+    double tileDistance(const QGV::GeoTilePos& tilePos) const;
 
 private:
+    friend class QGVLayerTilesComposite;
     void processCamera();
+    QRect tilesRect(int zoom, const QRectF& projRect, int margin) const;
+    void releaseOffscreen();
+    void updateVelocity(const QPointF& tileCenter, bool reset);
+    QRect prefetchRect(const QRect& activeRect, const QRect& maxRect) const;
+    bool isTileActive(const QGV::GeoTilePos& tilePos) const;
+    bool hasTileData(const QGV::GeoTilePos& tilePos) const;
+    void pruneMissing();
     void removeAllAbove(const QGV::GeoTilePos& tilePos);
     void removeWhenCovered(const QGV::GeoTilePos& tilePos);
     void addTile(const QGV::GeoTilePos& tilePos, QGVDrawItem* tileObj);
     void removeTile(const QGV::GeoTilePos& tilePos);
+    void releaseRequest(const QGV::GeoTilePos& tilePos);
+    void requestTile(const QGV::GeoTilePos& tilePos);
+    void cancelTile(const QGV::GeoTilePos& tilePos);
+    QList<QGVLayerTiles*> takeWaiters(const QGV::GeoTilePos& tilePos);
+    void releaseShared();
     bool isTileExists(const QGV::GeoTilePos& tilePos) const;
     bool isTileFinished(const QGV::GeoTilePos& tilePos) const;
-    QList<QGV::GeoTilePos> existingTiles(int zoom) const;
+    void cacheTile(const QGV::GeoTilePos& tilePos, QGVDrawItem* tileObj);
+    QGVDrawItem* cachedTile(const QGV::GeoTilePos& tilePos);
+    void resetTiles();
+    void onMapState(QGV::MapState state);
+    void onSettled();
+    void onCameraPlan(const QList<QGVCameraState>& states);
+    void onParkTimeout();
+    void onRefreshTimeout();
+    int zoomForScale(double scale) const;
 
 private:
+    struct Coverage
+    {
+        QGV::GeoRect geoRect;
+        int fromZoom;
+        int toZoom;
+    };
+
+    int mLayerId;
     int mCurZoom;
     QRect mCurRect;
-    QMap<int, QMap<QGV::GeoTilePos, QGVDrawItem*>> mIndex;
+    QRect mPrefetchRect;
+    int mPrefetchTiles;
+    bool mOverzoom;
+    int mCoarseLevels;
+    QList<Coverage> mCoverage;
+    int mNoDataZoom;
+    QBitArray mNoData;
+    QHash<quint64, qint64> mMissing;
+    QSet<quint64> mPlanned;
+    int mCancelGrace;
+    QHash<quint64, qint64> mParked;
+    QElapsedTimer mParkClock;
+    QTimer mParkTimer;
+    int mTileTtl;
+    QHash<quint64, qint64> mFetched;
+    QSet<quint64> mRefreshing;
+    QElapsedTimer mRefreshClock;
+    QTimer mRefreshTimer;
+    QElapsedTimer mMissingClock;
+    bool mBatchPaint;
+    bool mCompressedTiles;
+    bool mSnapToZoom;
+    QGV::MapState mMapState;
+    int mSettleDelay;
+    int mSettleDeadline;
+    QTimer mSettleTimer;
+    QElapsedTimer mSettleStart;
+    QGVLayerTilesPainter* mPainter;
+    QGVLayerTilesComposite* mComposite;
+    QPointF mLastCenter;
+    QPointF mVelocity;
+    QElapsedTimer mVelocityTimer;
+    QGVTileIndex mIndex;
     QElapsedTimer mLastAnimation;
+    QSharedPointer<QGVTileCache> mCache;
 };
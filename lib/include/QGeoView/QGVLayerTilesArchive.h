@@ -0,0 +1,49 @@
+/***************************************************************************
+ * QGeoView is a Qt / C ++ widget for visualizing geographic data.
+ * Copyright (C) 2018-2020 Andrey Yaroshenko.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see https://www.gnu.org/licenses.
+ ****************************************************************************/
+
+#pragma once
+
+#include "QGVLayerTilesAsync.h"
+#include "QGVTileArchive.h"
+
+#include <QSharedPointer>
+
+/*!
+ * Tile layer for tiles packed into single archive file (see QGVTileArchive).
+ * Zoom range is taken from archive, tiles are decoded by the tile worker directly
+ * from mapped archive data.
+ */
+class QGV_LIB_DECL QGVLayerTilesArchive : public QGVLayerTilesAsync
+{
+    Q_OBJECT
+
+public:
+    explicit QGVLayerTilesArchive(const QString& fileName);
+
+    QSharedPointer<QGVTileArchive> getArchive() const;
+
+    QString getTileSource() const override;
+
+protected:
+    int minZoomlevel() const override;
+    int maxZoomlevel() const override;
+    QGVTileWorker::Job createJob(const QGV::GeoTilePos& tilePos) const override;
+
+private:
+    QSharedPointer<QGVTileArchive> mArchive;
+};
@@ -0,0 +1,54 @@
+/***************************************************************************
+ * QGeoView is a Qt / C ++ widget for visualizing geographic data.
+ * Copyright (C) 2018-2020 Andrey Yaroshenko.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see https://www.gnu.org/licenses.
+ ****************************************************************************/
+
+#pragma once
+
+#include "QGVLayerTiles.h"
+
+/*!
+ * Base for custom tile layers with expensive tile production.
+ * Instead of producing tile inside request() subclass returns job which is executed by the
+ * tile worker in thread pool. Job should check canceled flag to stop early, cancel() of tile
+ * sets it. Resulting image is delivered in GUI thread and converted to tile by createTile(),
+ * null image means that tile doesn't exist.
+ */
+class QGV_LIB_DECL QGVLayerTilesAsync : public QGVLayerTiles
+{
+    Q_OBJECT
+
+public:
+    QGVLayerTilesAsync();
+    ~QGVLayerTilesAsync();
+
+    int countJobs() const;
+
+protected:
+    virtual QGVTileWorker::Job createJob(const QGV::GeoTilePos& tilePos) const = 0;
+
+    void onClean() override;
+    void request(const QGV::GeoTilePos& tilePos) override;
+    void cancel(const QGV::GeoTilePos& tilePos) override;
+    bool isRequestInFlight(const QGV::GeoTilePos& tilePos) const override;
+
+private:
+    void onJobFinished(const QGV::GeoTilePos& tilePos, const QImage& image);
+    void cancelAll();
+
+private:
+    QMap<QGV::GeoTilePos, quint64> mJobs;
+};
@@ -0,0 +1,73 @@
+/***************************************************************************
+ * QGeoView is a Qt / C ++ widget for visualizing geographic data.
+ * Copyright (C) 2018-2020 Andrey Yaroshenko.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see https://www.gnu.org/licenses.
+ ****************************************************************************/
+
+#pragma once
+
+#include "QGVLayerTiles.h"
+
+#include <QBitArray>
+
+/*!
+ * Tile layer which composes tiles of several member layers.
+ * Member layers are owned by composite and are not shown by themselves: composite requests
+ * the same tile from all members and, when all of them answered, blends member images
+ * (in order of adding and with member opacity) on the tile worker. Only the blended image is
+ * shown and cached, so stacked layers cost as much as one layer when painting.
+ * Members must create QGVImage tiles, other tiles are treated as missing.
+ */
+class QGV_LIB_DECL QGVLayerTilesComposite : public QGVLayerTiles
+{
+    Q_OBJECT
+
+public:
+    QGVLayerTilesComposite();
+    ~QGVLayerTilesComposite();
+
+    void addLayer(QGVLayerTiles* layer);
+    int countLayers() const;
+    QGVLayerTiles* getLayer(int index) const;
+
+    QString getTileSource() const override;
+
+protected:
+    void onProjection(QGVMap* geoMap) override;
+    void onClean() override;
+    int minZoomlevel() const override;
+    int maxZoomlevel() const override;
+    void request(const QGV::GeoTilePos& tilePos) override;
+    void cancel(const QGV::GeoTilePos& tilePos) override;
+    bool isRequestInFlight(const QGV::GeoTilePos& tilePos) const override;
+
+private:
+    friend class QGVLayerTiles;
+    void onLayerTile(QGVLayerTiles* layer, const QGV::GeoTilePos& tilePos, QGVDrawItem* tileObj);
+    void onLayerImage(QGVLayerTiles* layer, const QGV::GeoTilePos& tilePos, const QImage& image);
+    void blendTile(const QGV::GeoTilePos& tilePos);
+    void onTileBlended(const QGV::GeoTilePos& tilePos, const QImage& image);
+
+private:
+    struct Parts
+    {
+        QVector<QImage> images;
+        QBitArray received;
+    };
+
+    QList<QGVLayerTiles*> mLayers;
+    QMap<QGV::GeoTilePos, Parts> mParts;
+    QMap<QGV::GeoTilePos, quint64> mBlending;
+};
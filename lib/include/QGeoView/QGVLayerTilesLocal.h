@@ -0,0 +1,50 @@
+/***************************************************************************
+ * QGeoView is a Qt / C ++ widget for visualizing geographic data.
+ * Copyright (C) 2018-2020 Andrey Yaroshenko.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see https://www.gnu.org/licenses.
+ ****************************************************************************/
+
+#pragma once
+
+#include "QGVLayerTilesAsync.h"
+
+/*!
+ * Tile layer for tiles stored in local directory tree (e.g. "/data/tiles/${z}/${x}/${y}.png").
+ * Template placeholders are ${z}, ${x}, ${y} and ${-y} (TMS row numbering). Files are read and
+ * decoded by the tile worker, absent files are treated as missing tiles.
+ */
+class QGV_LIB_DECL QGVLayerTilesLocal : public QGVLayerTilesAsync
+{
+    Q_OBJECT
+
+public:
+    explicit QGVLayerTilesLocal(const QString& pathTemplate, int minZoom = 0, int maxZoom = 20);
+
+    void setPathTemplate(const QString& pathTemplate);
+    QString getPathTemplate() const;
+
+    QString getTileSource() const override;
+
+protected:
+    int minZoomlevel() const override;
+    int maxZoomlevel() const override;
+    QGVTileWorker::Job createJob(const QGV::GeoTilePos& tilePos) const override;
+    virtual QString tilePosToPath(const QGV::GeoTilePos& tilePos) const;
+
+private:
+    QString mPathTemplate;
+    int mMinZoom;
+    int mMaxZoom;
+};
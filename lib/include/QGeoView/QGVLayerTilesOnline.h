@@ -19,27 +19,104 @@
 #pragma once
 
 #include "QGVLayerTiles.h"
+#include "QGVTileFetcher.h"
 
-#include <QNetworkReply>
+#include <QSet>
 
 class QGV_LIB_DECL QGVLayerTilesOnline : public QGVLayerTiles
 {
     Q_OBJECT
 
 public:
+    struct Statistics
+    {
+        int requests;
+        int succeeded;
+        int failed;
+        int retries;
+        int missing;
+        int rejected;
+        int hedged;
+    };
+
+    QGVLayerTilesOnline();
     ~QGVLayerTilesOnline();
 
+    QString getTileSource() const override;
+    void setMaxRequests(int requests);
+    int getMaxRequests() const;
+    int countQueued() const;
+    int countRequests() const;
+    void setMaxRetries(int retries);
+    int getMaxRetries() const;
+    void setRetryDelay(int msDelay);
+    int getRetryDelay() const;
+    void setFailureTimeout(int msTimeout);
+    int getFailureTimeout() const;
+    void setHedgeQuantile(double quantile);
+    double getHedgeQuantile() const;
+    Statistics getStatistics() const;
+    void resetStatistics();
+
+    static void setMaxRequestsPerHost(int requests);
+    static int getMaxRequestsPerHost();
+
 protected:
     virtual QString tilePosToUrl(const QGV::GeoTilePos& tilePos) const = 0;
+    virtual QString tilePosToMirrorUrl(const QGV::GeoTilePos& tilePos, int mirror) const;
+    virtual int countMirrors() const;
+    int tileMirror(const QGV::GeoTilePos& tilePos) const;
 
 private:
-    void onProjection(QGVMap* geoMap) override;
     void onClean() override;
     void request(const QGV::GeoTilePos& tilePos) override;
     void cancel(const QGV::GeoTilePos& tilePos) override;
-    void onReplyFinished(QNetworkReply* reply);
+    bool isRequestInFlight(const QGV::GeoTilePos& tilePos) const override;
+    void revalidate(const QGV::GeoTilePos& tilePos) override;
+    void onReplyFinished(const QGV::GeoTilePos& tilePos, int mirror, const QGVTileFetcher::Reply& reply);
+    void onRevalidated(const QGV::GeoTilePos& tilePos, const QGVTileFetcher::Reply& reply);
+    void scheduleLater();
+    int freeMirror(const QGV::GeoTilePos& tilePos, int excluded) const;
+    void sendRequest(const QGV::GeoTilePos& tilePos, int mirror);
+    void scheduleHedge(const QGV::GeoTilePos& tilePos);
+    void onHedge(const QGV::GeoTilePos& tilePos, quint64 ticket);
+    void addLatency(int msLatency);
+    bool isHigherPriority(const QGV::GeoTilePos& left, const QGV::GeoTilePos& right) const;
+    void decodeTile(const QGV::GeoTilePos& tilePos, const QString& url, const QByteArray& rawImage);
+    void onTileDecoded(const QGV::GeoTilePos& tilePos, const QString& url, QGVDrawItem* tile);
     void removeReply(const QGV::GeoTilePos& tilePos);
+    void removeReply(const QGV::GeoTilePos& tilePos, int mirror);
+    void removeDecoding(const QGV::GeoTilePos& tilePos);
+    void onFailure(const QGV::GeoTilePos& tilePos, const QString& error);
+    void onRetry(quint64 tileKey);
+
+private Q_SLOTS:
+    void onSchedule();
 
 private:
-    QMap<QGV::GeoTilePos, QNetworkReply*> mRequest;
+    struct Request
+    {
+        quint64 ticket;
+        int mirror;
+        QString host;
+        qint64 sent;
+    };
+
+    int mMaxRequests;
+    int mMaxRetries;
+    int mRetryDelay;
+    int mFailureTimeout;
+    double mHedgeQuantile;
+    QVector<int> mLatencies;
+    int mLatencyIndex;
+    QElapsedTimer mClock;
+    Statistics mStatistics;
+    QHash<quint64, int> mFailures;
+    QSet<quint64> mRetrying;
+    QSet<quint64> mRevalidating;
+    QHash<quint64, QPair<QByteArray, QByteArray>> mValidators;
+    bool mSchedulePending;
+    QList<quint64> mQueue;
+    QMap<QGV::GeoTilePos, QList<Request>> mRequest;
+    QMap<QGV::GeoTilePos, quint64> mDecoding;
 };
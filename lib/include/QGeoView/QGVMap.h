@@ -84,6 +84,7 @@ public:
 
     virtual void onMapState(QGV::MapState state);
     virtual void onMapCamera(const QGVCameraState& oldState, const QGVCameraState& newState);
+    virtual void onMapCameraPlan(const QList<QGVCameraState>& states);
 
 protected:
     void mouseMoveEvent(QMouseEvent* event) override;
@@ -95,6 +96,7 @@ Q_SIGNALS:
     void areaChanged();
     void itemsChanged(QGVItem* parent);
     void stateChanged(QGV::MapState state);
+    void cameraPlanned(const QList<QGVCameraState>& states);
     void itemClicked(QGVItem* item, QPointF projPos);
     void itemDoubleClicked(QGVItem* item, QPointF projPos);
     void mapMouseMove(QPointF projPos);
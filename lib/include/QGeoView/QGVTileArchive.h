@@ -0,0 +1,65 @@
+/***************************************************************************
+ * QGeoView is a Qt / C ++ widget for visualizing geographic data.
+ * Copyright (C) 2018-2020 Andrey Yaroshenko.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see https://www.gnu.org/licenses.
+ ****************************************************************************/
+
+#pragma once
+
+#include "QGVGlobal.h"
+
+#include <QFile>
+
+/*!
+ * Read-only single-file tile archive.
+ * File layout (all numbers are little-endian):
+ *  - header: magic "QGVTILE1", entry count, directory offset, reserved (4 x 8 bytes);
+ *  - tile blobs;
+ *  - directory: entries (tile key, offset, size) of 3 x 8 bytes sorted by tile key
+ *    (see QGV::GeoTilePos::toKey, Morton order inside of zoom level).
+ * Whole file is memory-mapped, lookup is binary search over mapped directory and
+ * returned data is not copied. Data returned by find() stays valid until archive is destroyed.
+ * All const methods are thread-safe.
+ */
+class QGV_LIB_DECL QGVTileArchive
+{
+public:
+    explicit QGVTileArchive(const QString& fileName);
+    ~QGVTileArchive();
+
+    bool isOpen() const;
+    QString getFileName() const;
+    int count() const;
+    int minZoomlevel() const;
+    int maxZoomlevel() const;
+
+    bool contains(const QGV::GeoTilePos& tilePos) const;
+    QByteArray find(const QGV::GeoTilePos& tilePos) const;
+
+    static bool pack(const QString& directory, const QString& fileName);
+
+private:
+    Q_DISABLE_COPY(QGVTileArchive)
+    void open();
+    const uchar* findEntry(quint64 tileKey) const;
+    quint64 entryKey(int index) const;
+
+private:
+    QFile mFile;
+    const uchar* mData;
+    const uchar* mDirectory;
+    qint64 mSize;
+    int mCount;
+};
@@ -0,0 +1,64 @@
+/***************************************************************************
+ * QGeoView is a Qt / C ++ widget for visualizing geographic data.
+ * Copyright (C) 2018-2020 Andrey Yaroshenko.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see https://www.gnu.org/licenses.
+ ****************************************************************************/
+
+#pragma once
+
+#include "QGVGlobal.h"
+
+#include <QCache>
+#include <QImage>
+#include <QPair>
+#include <QSharedPointer>
+
+/*!
+ * LRU cache of tile images with memory budget in bytes.
+ * Tiles are identified by tile source (see QGVLayerTiles::getTileSource) and tile position,
+ * so one cache can be shared between several layers. Tile is kept either decoded or encoded
+ * (for tiles of compressed mode), encoded tile costs its data size.
+ */
+class QGV_LIB_DECL QGVTileCache
+{
+public:
+    explicit QGVTileCache(qint64 maxBytes = 32 * 1024 * 1024);
+
+    void setMaxBytes(qint64 bytes);
+    qint64 getMaxBytes() const;
+    qint64 getBytes() const;
+    int count() const;
+
+    void insert(const QString& source, const QGV::GeoTilePos& tilePos, const QImage& image);
+    void insertEncoded(const QString& source, const QGV::GeoTilePos& tilePos, const QByteArray& rawData);
+    QImage find(const QString& source, const QGV::GeoTilePos& tilePos);
+    QByteArray findEncoded(const QString& source, const QGV::GeoTilePos& tilePos);
+    bool contains(const QString& source, const QGV::GeoTilePos& tilePos) const;
+    void remove(const QString& source, const QGV::GeoTilePos& tilePos);
+    void clear();
+    void trim(qint64 bytes);
+
+    static QSharedPointer<QGVTileCache> shared();
+
+private:
+    Q_DISABLE_COPY(QGVTileCache)
+    struct Entry
+    {
+        QImage image;
+        QByteArray encoded;
+    };
+    typedef QPair<QString, quint64> Key;
+    QCache<Key, Entry> mCache;
+};
@@ -0,0 +1,80 @@
+/***************************************************************************
+ * QGeoView is a Qt / C ++ widget for visualizing geographic data.
+ * Copyright (C) 2018-2020 Andrey Yaroshenko.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see https://www.gnu.org/licenses.
+ ****************************************************************************/
+
+#pragma once
+
+#include "QGVGlobal.h"
+
+#include <QAtomicInt>
+#include <QMap>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QObject>
+#include <QSharedPointer>
+#include <QThread>
+
+#include <functional>
+
+struct QGVTileFetcherTask;
+
+/*!
+ * Network client for tile requests. Network access manager lives in own thread, so socket reads
+ * and start of new requests are not delayed by busy GUI thread. Each request has own callback, which
+ * is executed in the fetcher thread (GUI) and only if request was not canceled.
+ */
+class QGV_LIB_DECL QGVTileFetcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Reply
+    {
+        QUrl url;
+        QNetworkReply::NetworkError error;
+        QString errorString;
+        int status;
+        QByteArray eTag;
+        QByteArray lastModified;
+        QByteArray data;
+    };
+    typedef std::function<void(const Reply& reply)> Callback;
+
+    explicit QGVTileFetcher(QObject* parent = nullptr);
+    ~QGVTileFetcher();
+
+    void setCacheDirectory(const QString& path, qint64 maxBytes = 0);
+    int countRequests() const;
+
+    quint64 fetch(const QNetworkRequest& request, const Callback& callback);
+    void cancel(quint64 ticket);
+    void cancelAll();
+
+private Q_SLOTS:
+    void onFetchFinished(quint64 ticket);
+
+private:
+    QNetworkAccessManager* manager();
+    void start(quint64 ticket, const QSharedPointer<QGVTileFetcherTask>& task);
+
+private:
+    QThread mThread;
+    QObject* mSession;
+    QNetworkAccessManager* mManager;
+    quint64 mLastTicket;
+    QMap<quint64, QSharedPointer<QGVTileFetcherTask>> mTasks;
+};
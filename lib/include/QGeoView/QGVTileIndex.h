@@ -0,0 +1,98 @@
+/***************************************************************************
+ * QGeoView is a Qt / C ++ widget for visualizing geographic data.
+ * Copyright (C) 2018-2020 Andrey Yaroshenko.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see https://www.gnu.org/licenses.
+ ****************************************************************************/
+
+#pragma once
+
+#include "QGVGlobal.h"
+
+#include <QMap>
+
+class QGVDrawItem;
+
+/*!
+ * Tile state index.
+ * Tiles are stored in map ordered by packed 64-bit key (see QGV::GeoTilePos::toKey), so all
+ * descendants of the tile at given zoom are one continuous range of keys and all ancestors are
+ * found by direct lookups.
+ * Value nullptr means tile is requested, but not finished yet.
+ */
+class QGV_LIB_DECL QGVTileIndex
+{
+public:
+    /*!
+     * Iterator over tiles of key ranges of one or several zoom levels. It keeps current key
+     * instead of map iterator, so tiles can be removed from index while iterating.
+     */
+    class QGV_LIB_DECL Iterator
+    {
+    public:
+        QGV::GeoTilePos operator*() const;
+        Iterator& operator++();
+        bool operator!=(const Iterator& other) const;
+
+    private:
+        friend class QGVTileIndex;
+        Iterator();
+        Iterator(const QGVTileIndex* index, quint64 rootKey, int fromZoom, int toZoom);
+        void seek(quint64 fromKey);
+
+    private:
+        const QGVTileIndex* mIndex;
+        quint64 mRootKey;
+        int mZoom;
+        int mLastZoom;
+        quint64 mKey;
+        quint64 mToKey;
+    };
+
+    class QGV_LIB_DECL Range
+    {
+    public:
+        Iterator begin() const;
+        Iterator end() const;
+
+    private:
+        friend class QGVTileIndex;
+        Range(const QGVTileIndex* index, quint64 rootKey, int fromZoom, int toZoom);
+
+    private:
+        const QGVTileIndex* mIndex;
+        quint64 mRootKey;
+        int mFromZoom;
+        int mToZoom;
+    };
+
+    QGVTileIndex();
+
+    void insert(const QGV::GeoTilePos& tilePos, QGVDrawItem* tile);
+    QGVDrawItem* take(const QGV::GeoTilePos& tilePos);
+    QGVDrawItem* value(const QGV::GeoTilePos& tilePos) const;
+    bool contains(const QGV::GeoTilePos& tilePos) const;
+    bool isFinished(const QGV::GeoTilePos& tilePos) const;
+    bool isEmpty() const;
+    int count() const;
+    void clear();
+
+    Range tiles(int zoom) const;
+    QList<QGV::GeoTilePos> ancestors(const QGV::GeoTilePos& tilePos) const;
+    Range descendants(const QGV::GeoTilePos& tilePos) const;
+    Range descendants(const QGV::GeoTilePos& tilePos, int zoom) const;
+
+private:
+    QMap<quint64, QGVDrawItem*> mTiles;
+};
@@ -0,0 +1,80 @@
+/***************************************************************************
+ * QGeoView is a Qt / C ++ widget for visualizing geographic data.
+ * Copyright (C) 2018-2020 Andrey Yaroshenko.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see https://www.gnu.org/licenses.
+ ****************************************************************************/
+
+#pragma once
+
+#include "QGVGlobal.h"
+
+#include <QFile>
+#include <QHash>
+#include <QPair>
+
+/*!
+ * Persistent tile store.
+ * Raw tile data is appended to single pack file and located by compact index
+ * of fixed-size records (source, zoom, x, y -> offset, size). Index is loaded into hash on open,
+ * pack file is memory-mapped by large chunks, so lookup is O(1). Data returned by find() is owned by caller.
+ * Pack file doesn't grow over size limit. When it is almost full or a quarter of it is dead data,
+ * store is compacted on next open and oldest tiles are dropped to fit three quarters of the limit.
+ */
+class QGV_LIB_DECL QGVTileStore
+{
+public:
+    explicit QGVTileStore(const QString& directory, qint64 maxBytes = 512 * 1024 * 1024);
+    ~QGVTileStore();
+
+    bool isOpen() const;
+    QString getDirectory() const;
+    void setMaxBytes(qint64 bytes);
+    qint64 getMaxBytes() const;
+    int count() const;
+    qint64 size() const;
+
+    bool contains(const QString& source, const QGV::GeoTilePos& tilePos) const;
+    QByteArray find(const QString& source, const QGV::GeoTilePos& tilePos);
+    bool insert(const QString& source, const QGV::GeoTilePos& tilePos, const QByteArray& rawData);
+    void flush();
+
+    static quint64 sourceId(const QString& source);
+
+private:
+    Q_DISABLE_COPY(QGVTileStore)
+    struct Entry
+    {
+        qint64 offset;
+        qint64 size;
+    };
+    typedef QPair<quint64, quint64> Key;
+
+    void open();
+    bool openFiles();
+    void loadIndex();
+    bool isCompactNeeded() const;
+    bool compact();
+    const uchar* mappedData(qint64 offset, qint64* available);
+
+private:
+    QString mDirectory;
+    qint64 mMaxBytes;
+    QFile mPack;
+    QFile mIndex;
+    qint64 mPackSize;
+    int mUnflushed;
+    QHash<Key, Entry> mEntries;
+    QHash<qint64, QPair<uchar*, qint64>> mMapped;
+};
@@ -0,0 +1,79 @@
+/***************************************************************************
+ * QGeoView is a Qt / C ++ widget for visualizing geographic data.
+ * Copyright (C) 2018-2020 Andrey Yaroshenko.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see https://www.gnu.org/licenses.
+ ****************************************************************************/
+
+#pragma once
+
+#include "QGVGlobal.h"
+
+#include <QAtomicInt>
+#include <QImage>
+#include <QMap>
+#include <QObject>
+#include <QSharedPointer>
+#include <QThreadPool>
+
+#include <functional>
+
+struct QGVTileWorkerTask;
+
+/*!
+ * Bounded worker pool for per-tile jobs (decoding, file reading, rendering).
+ * Job is executed in pool thread, callback is executed in the worker thread (GUI) and
+ * only if job was not canceled. At most maxThreads + maxQueueDepth jobs are handed to
+ * the thread pool, all other jobs wait in the worker and can be canceled for free.
+ */
+class QGV_LIB_DECL QGVTileWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    typedef std::function<QImage(const QAtomicInt& canceled)> Job;
+    typedef std::function<void(const QImage& image)> Callback;
+
+    explicit QGVTileWorker(QObject* parent = nullptr);
+    ~QGVTileWorker();
+
+    void setMaxThreads(int count);
+    int getMaxThreads() const;
+    void setMaxQueueDepth(int depth);
+    int getMaxQueueDepth() const;
+    int countJobs() const;
+
+    quint64 run(const Job& job, const Callback& callback);
+    void cancel(quint64 ticket);
+    void cancelAll();
+    bool isWaiting(quint64 ticket) const;
+
+    static QImage decode(const QByteArray& rawData);
+    static QImage toDisplayFormat(const QImage& image);
+    static QGVTileWorker* shared();
+
+private Q_SLOTS:
+    void onJobFinished(quint64 ticket);
+
+private:
+    void dispatch();
+
+private:
+    QThreadPool mPool;
+    int mMaxQueueDepth;
+    int mSubmitted;
+    quint64 mLastTicket;
+    QMap<quint64, QSharedPointer<QGVTileWorkerTask>> mTasks;
+    QList<quint64> mWaiting;
+};
@@ -13,6 +13,10 @@ SOURCES += \
     $$PWD/src/QGVLayerGoogle.cpp \
     $$PWD/src/QGVLayerOSM.cpp \
     $$PWD/src/QGVLayerTiles.cpp \
+    $$PWD/src/QGVLayerTilesArchive.cpp \
+    $$PWD/src/QGVLayerTilesAsync.cpp \
+    $$PWD/src/QGVLayerTilesComposite.cpp \
+    $$PWD/src/QGVLayerTilesLocal.cpp \
     $$PWD/src/QGVLayerTilesOnline.cpp \
     $$PWD/src/QGVMap.cpp \
     $$PWD/src/QGVMapQGItem.cpp \
@@ -20,6 +24,12 @@ SOURCES += \
     $$PWD/src/QGVMapRubberBand.cpp \
     $$PWD/src/QGVProjection.cpp \
     $$PWD/src/QGVProjectionEPSG3857.cpp \
+    $$PWD/src/QGVTileArchive.cpp \
+    $$PWD/src/QGVTileCache.cpp \
+    $$PWD/src/QGVTileFetcher.cpp \
+    $$PWD/src/QGVTileIndex.cpp \
+    $$PWD/src/QGVTileStore.cpp \
+    $$PWD/src/QGVTileWorker.cpp \
     $$PWD/src/QGVWidget.cpp \
     $$PWD/src/QGVWidgetCompass.cpp \
     $$PWD/src/QGVWidgetScale.cpp \
@@ -37,6 +47,10 @@ HEADERS += \
     $$PWD/include/QGeoView/QGVLayerGoogle.h \
     $$PWD/include/QGeoView/QGVLayerOSM.h \
     $$PWD/include/QGeoView/QGVLayerTiles.h \
+    $$PWD/include/QGeoView/QGVLayerTilesArchive.h \
+    $$PWD/include/QGeoView/QGVLayerTilesAsync.h \
+    $$PWD/include/QGeoView/QGVLayerTilesComposite.h \
+    $$PWD/include/QGeoView/QGVLayerTilesLocal.h \
     $$PWD/include/QGeoView/QGVLayerTilesOnline.h \
     $$PWD/include/QGeoView/QGVMap.h \
     $$PWD/include/QGeoView/QGVMapQGItem.h \
@@ -44,6 +58,12 @@ HEADERS += \
     $$PWD/include/QGeoView/QGVMapRubberBand.h \
     $$PWD/include/QGeoView/QGVProjection.h \
     $$PWD/include/QGeoView/QGVProjectionEPSG3857.h \
+    $$PWD/include/QGeoView/QGVTileArchive.h \
+    $$PWD/include/QGeoView/QGVTileCache.h \
+    $$PWD/include/QGeoView/QGVTileFetcher.h \
+    $$PWD/include/QGeoView/QGVTileIndex.h \
+    $$PWD/include/QGeoView/QGVTileStore.h \
+    $$PWD/include/QGeoView/QGVTileWorker.h \
     $$PWD/include/QGeoView/QGVWidget.h \
     $$PWD/include/QGeoView/QGVWidgetCompass.h \
     $$PWD/include/QGeoView/QGVWidgetScale.h \
@@ -244,6 +244,23 @@ void QGVCameraAnimation::onStart()
 void QGVCameraAnimation::onStop()
 {}
 
+/*!
+ * Camera states which animation will pass through, published to map at animation start
+ * so tile layers can load them in advance. Default is destination state only.
+ */
+QList<QGVCameraState> QGVCameraAnimation::plannedStates() const
+{
+    return { plannedState(mActions.scale(), mActions.projCenter()) };
+}
+
+QGVCameraState QGVCameraAnimation::plannedState(double scale, const QPointF& projCenter) const
+{
+    const QGVCameraState& origin = mActions.origin();
+    QRectF projRect(QPointF(), origin.projRect().size() * (origin.scale() / scale));
+    projRect.moveCenter(projCenter);
+    return QGVCameraState(origin.getMap(), mActions.azimuth(), scale, projRect, true);
+}
+
 double QGVCameraAnimation::interpolateScale(double from, double to, double progress)
 {
     if (qFuzzyCompare(from, to)) {
@@ -280,11 +297,15 @@ void QGVCameraAnimation::updateState(QAbstractAnimation::State newState, QAbstra
         mActions.rebase(geoMap->getCamera());
         connect(geoMap, &QGVMap::stateChanged, this, &QGVCameraAnimation::onStateChanged);
         onStart();
+        if (direction() == Direction::Forward) {
+            geoMap->onMapCameraPlan(plannedStates());
+        }
     }
     if (newState == QAbstractAnimation::Stopped && oldState != QAbstractAnimation::Stopped) {
         disconnect(geoMap, nullptr, this, nullptr);
         geoMap->cameraTo(QGVCameraActions(geoMap), false);
         onStop();
+        geoMap->onMapCameraPlan({});
     }
 }
 
@@ -367,3 +388,8 @@ void QGVCameraFlyAnimation::onProgress(double progress, QGVCameraActions& target
 
     target.rotateTo(interpolateAzimuth(actions().origin().azimuth(), actions().azimuth(), progress));
 }
+
+QList<QGVCameraState> QGVCameraFlyAnimation::plannedStates() const
+{
+    return { plannedState(actions().scale(), actions().projCenter()), plannedState(mFlyScale, mFlyAnchor) };
+}
@@ -94,6 +94,8 @@ void QGVDrawItem::refresh()
     mQGDrawItem->setOpacity(effectiveOpacity());
     mQGDrawItem->setZValue(effectiveZValue());
     mQGDrawItem->setAcceptHoverEvents(isFlag(QGV::ItemFlag::Highlightable));
+    mQGDrawItem->setCacheMode(isFlag(QGV::ItemFlag::Uncached) ? QGraphicsItem::NoCache
+                                                               : QGraphicsItem::DeviceCoordinateCache);
     if (QGV::isDrawDebug()) {
         setProperty("updateCount", property("updateCount").toInt() + 1);
     }
@@ -106,6 +108,13 @@ void QGVDrawItem::repaint()
     }
 }
 
+void QGVDrawItem::repaint(const QRectF& projRect)
+{
+    if (!mQGDrawItem.isNull()) {
+        mQGDrawItem->update(projRect);
+    }
+}
+
 void QGVDrawItem::resetBoundary()
 {
     if (!mQGDrawItem.isNull()) {
@@ -27,6 +27,32 @@ namespace {
 bool drawDebugEnabled = false;
 bool printDebugEnabled = false;
 QNetworkAccessManager* networkManager = nullptr;
+QGVTileStore* tileStore = nullptr;
+QGVTileFetcher* tileFetcher = nullptr;
+const int tileKeyZoomShift = 58;
+const quint64 tileKeyMortonMask = (Q_UINT64_C(1) << tileKeyZoomShift) - 1;
+
+quint64 spreadBits(quint32 value)
+{
+    quint64 x = value;
+    x = (x | (x << 16)) & Q_UINT64_C(0x0000FFFF0000FFFF);
+    x = (x | (x << 8)) & Q_UINT64_C(0x00FF00FF00FF00FF);
+    x = (x | (x << 4)) & Q_UINT64_C(0x0F0F0F0F0F0F0F0F);
+    x = (x | (x << 2)) & Q_UINT64_C(0x3333333333333333);
+    x = (x | (x << 1)) & Q_UINT64_C(0x5555555555555555);
+    return x;
+}
+
+quint32 compactBits(quint64 value)
+{
+    quint64 x = value & Q_UINT64_C(0x5555555555555555);
+    x = (x | (x >> 1)) & Q_UINT64_C(0x3333333333333333);
+    x = (x | (x >> 2)) & Q_UINT64_C(0x0F0F0F0F0F0F0F0F);
+    x = (x | (x >> 4)) & Q_UINT64_C(0x00FF00FF00FF00FF);
+    x = (x | (x >> 8)) & Q_UINT64_C(0x0000FFFF0000FFFF);
+    x = (x | (x >> 16)) & Q_UINT64_C(0x00000000FFFFFFFF);
+    return static_cast<quint32>(x);
+}
 }
 
 namespace QGV {
@@ -387,6 +413,30 @@ QString GeoTilePos::toQuadKey() const
     return quadKey;
 }
 
+/*!
+ * Packed 64-bit tile key.
+ * Bits 58..63 hold zoom level, bits 0..57 hold Morton code (x - even bits, y - odd bits).
+ * Keys are ordered by zoom first, so all descendants of a tile at some zoom
+ * form one continuous key range.
+ */
+quint64 GeoTilePos::toKey() const
+{
+    Q_ASSERT(mZoom >= 0 && mZoom <= 29);
+    const quint64 mortonX = spreadBits(static_cast<quint32>(mPos.x()));
+    const quint64 mortonY = spreadBits(static_cast<quint32>(mPos.y())) << 1;
+    const quint64 morton = mortonX | mortonY;
+    return (static_cast<quint64>(mZoom) << tileKeyZoomShift) | (morton & tileKeyMortonMask);
+}
+
+GeoTilePos GeoTilePos::fromKey(quint64 key)
+{
+    const int zoom = static_cast<int>(key >> tileKeyZoomShift);
+    const quint64 morton = key & tileKeyMortonMask;
+    const int x = static_cast<int>(compactBits(morton));
+    const int y = static_cast<int>(compactBits(morton >> 1));
+    return GeoTilePos(zoom, QPoint(x, y));
+}
+
 GeoTilePos GeoTilePos::geoToTilePos(int zoom, const GeoPos& geoPos)
 {
     const double lon = geoPos.longitude();
@@ -471,6 +521,26 @@ QNetworkAccessManager* getNetworkManager()
     return networkManager;
 }
 
+void setTileStore(QGVTileStore* store)
+{
+    tileStore = store;
+}
+
+QGVTileStore* getTileStore()
+{
+    return tileStore;
+}
+
+void setTileFetcher(QGVTileFetcher* fetcher)
+{
+    tileFetcher = fetcher;
+}
+
+QGVTileFetcher* getTileFetcher()
+{
+    return tileFetcher;
+}
+
 } // namespace QGV
 
 QDebug operator<<(QDebug debug, const QGV::GeoPos& value)
@@ -18,15 +18,31 @@
 
 #include "QGVImage.h"
 #include "QGVMap.h"
+#include "QGVTileWorker.h"
+
+#include <QBuffer>
+#include <QImageReader>
 
 #include <QNetworkReply>
 #include <QNetworkRequest>
 #include <QPainter>
+#include <QtMath>
+
+namespace {
+double exactSizeTolerance = 0.01;
+}
 
 QGVImage::QGVImage()
     : mGeometryType(GeometryType::ByRect)
+    , mDecodeTicket(0)
 {}
 
+QGVImage::~QGVImage()
+{
+    cancelDecode();
+    resetMips();
+}
+
 void QGVImage::setGeometry(const QGV::GeoRect& geoRect)
 {
     mGeometryType = GeometryType::ByRect;
@@ -43,14 +59,38 @@ void QGVImage::setGeometry(const QGV::GeoPos& geoPos, const QSize& imageSize, co
     calculateGeometry();
 }
 
+/*!
+ * Encoded image which is not decoded at the moment is decoded by this call (and not kept).
+ */
 QImage QGVImage::getImage() const
 {
+    if (mImage.isNull() && !mEncoded.isEmpty()) {
+        return QGVTileWorker::decode(mEncoded);
+    }
     return mImage;
 }
 
+QByteArray QGVImage::getEncoded() const
+{
+    return mEncoded;
+}
+
+/*!
+ * Size of image, encoded image is not decoded for it.
+ */
+QSize QGVImage::getImageSize() const
+{
+    if (mImage.isNull() && !mEncoded.isEmpty()) {
+        QBuffer buffer;
+        buffer.setData(mEncoded);
+        return QImageReader(&buffer).size();
+    }
+    return mImage.size();
+}
+
 bool QGVImage::isImage() const
 {
-    return !mImage.isNull();
+    return !mImage.isNull() || !mEncoded.isEmpty();
 }
 
 void QGVImage::load(const QString& url)
@@ -77,7 +117,44 @@ void QGVImage::loadImage(const QByteArray& rawData)
 
 void QGVImage::loadImage(const QImage& image)
 {
+    cancelDecode();
+    mEncoded.clear();
     mImage = image;
+    mPixmap = QPixmap();
+    resetMips();
+    repaint();
+    Q_EMIT imageChanged();
+}
+
+/*!
+ * Keeps image encoded (e.g. PNG or JPEG data), it is decoded in background when painted first time.
+ * Decoded pixels can be dropped by releaseImage() and are decoded again when needed.
+ * Image which is decoded already keeps showing old pixels until new data is decoded.
+ */
+void QGVImage::loadEncoded(const QByteArray& rawData)
+{
+    cancelDecode();
+    mEncoded = rawData;
+    if (!mImage.isNull()) {
+        startDecode();
+        return;
+    }
+    mImage = QImage();
+    mPixmap = QPixmap();
+    resetMips();
+    repaint();
+    Q_EMIT imageChanged();
+}
+
+void QGVImage::releaseImage()
+{
+    if (mEncoded.isEmpty() || (mImage.isNull() && mDecodeTicket == 0)) {
+        return;
+    }
+    cancelDecode();
+    mImage = QImage();
+    mPixmap = QPixmap();
+    resetMips();
 }
 
 void QGVImage::onProjection(QGVMap* geoMap)
@@ -104,15 +181,182 @@ QPointF QGVImage::projAnchor() const
 void QGVImage::projPaint(QPainter* painter)
 {
     if (mImage.isNull() || mProjRect.isEmpty()) {
+        requestDecode();
         return;
     }
-    QRectF paintRect = mProjRect;
-    if (!isFlag(QGV::ItemFlag::IgnoreScale)) {
-        const double pixelFactor = 1.0 / getMap()->getCamera().scale();
-        paintRect.setSize(paintRect.size() + QSizeF(pixelFactor, pixelFactor));
+    if (isFlag(QGV::ItemFlag::IgnoreScale)) {
+        painter->setRenderHint(QPainter::SmoothPixmapTransform);
+        painter->drawImage(mProjRect, mImage);
+        return;
     }
+    paint(painter, mProjRect, getMap()->getCamera());
+}
+
+/*!
+ * Paints image to given projection rect, can be used for images which are not added to the map.
+ */
+void QGVImage::paint(QPainter* painter, const QRectF& projRect, const QGVCameraState& camera)
+{
+    if (mImage.isNull() || projRect.isEmpty()) {
+        requestDecode();
+        return;
+    }
+    if (paintExact(painter, projRect)) {
+        return;
+    }
+    QRectF paintRect = projRect;
+    const double pixelFactor = 1.0 / camera.scale();
+    paintRect.setSize(paintRect.size() + QSizeF(pixelFactor, pixelFactor));
+    const QRectF visibleRect = paintRect.intersected(camera.projRect());
+    if (visibleRect.isEmpty()) {
+        return;
+    }
+    const QImage image = mipImage(painter, paintRect);
     painter->setRenderHint(QPainter::SmoothPixmapTransform);
-    painter->drawImage(paintRect, getImage());
+    if (visibleRect == paintRect) {
+        painter->drawImage(paintRect, image);
+        return;
+    }
+    /*
+     * Only visible part of image is scaled, it keeps paint cost constant for images
+     * which are much bigger than view (e.g. overzoomed tiles).
+     */
+    const double factorX = image.width() / paintRect.width();
+    const double factorY = image.height() / paintRect.height();
+    const QPointF sourceTopLeft((visibleRect.left() - paintRect.left()) * factorX,
+                                (visibleRect.top() - paintRect.top()) * factorY);
+    const QPointF sourceBottomRight((visibleRect.right() - paintRect.left()) * factorX,
+                                    (visibleRect.bottom() - paintRect.top()) * factorY);
+    const QRectF sourceRect = QRectF(QPointF(qFloor(sourceTopLeft.x()), qFloor(sourceTopLeft.y())),
+                                     QPointF(qCeil(sourceBottomRight.x()), qCeil(sourceBottomRight.y())))
+                                      .intersected(QRectF(image.rect()));
+    const QRectF targetRect(paintRect.left() + sourceRect.left() / factorX,
+                            paintRect.top() + sourceRect.top() / factorY,
+                            sourceRect.width() / factorX,
+                            sourceRect.height() / factorY);
+    painter->drawImage(targetRect, image, sourceRect);
+}
+
+/*!
+ * Fast path for image shown in its native size without rotation (e.g. tile at exact zoom level):
+ * unscaled pixel-aligned blit of pixmap without smoothing.
+ */
+bool QGVImage::paintExact(QPainter* painter, const QRectF& projRect)
+{
+    const QTransform transform = painter->deviceTransform();
+    if (transform.type() > QTransform::TxScale || transform.m11() <= 0 || transform.m22() <= 0) {
+        return false;
+    }
+    const QRectF deviceRect = transform.mapRect(projRect);
+    if (qAbs(deviceRect.width() - mImage.width()) > exactSizeTolerance ||
+        qAbs(deviceRect.height() - mImage.height()) > exactSizeTolerance) {
+        return false;
+    }
+    if (mPixmap.isNull()) {
+        mPixmap = QPixmap::fromImage(mImage);
+    }
+    painter->save();
+    painter->resetTransform();
+    painter->setRenderHint(QPainter::SmoothPixmapTransform, false);
+    painter->drawPixmap(QPoint(qRound(deviceRect.left()), qRound(deviceRect.top())), mPixmap);
+    painter->restore();
+    return true;
+}
+
+/*!
+ * Returns level of mip chain (each level is half of previous one) closest to size on the screen
+ * but not smaller than it. Missing levels are built in background, meanwhile the nearest bigger
+ * level is used.
+ */
+QImage QGVImage::mipImage(QPainter* painter, const QRectF& paintRect)
+{
+    const QTransform transform = painter->deviceTransform();
+    const double deviceWidth = QLineF(transform.map(paintRect.topLeft()), transform.map(paintRect.topRight())).length();
+    if (deviceWidth <= 0) {
+        return mImage;
+    }
+    int level = 0;
+    while ((mImage.width() >> (level + 1)) >= deviceWidth && (mImage.height() >> (level + 1)) > 0) {
+        ++level;
+    }
+    for (int ready = level; ready > 0; --ready) {
+        if (ready <= mMips.size() && !mMips[ready - 1].isNull()) {
+            if (ready != level) {
+                requestMip(level);
+            }
+            return mMips[ready - 1];
+        }
+    }
+    if (level > 0) {
+        requestMip(level);
+    }
+    return mImage;
+}
+
+void QGVImage::requestMip(int level)
+{
+    if (mMipTickets.contains(level)) {
+        return;
+    }
+    const QImage source = mImage;
+    const QSize size(qMax(1, mImage.width() >> level), qMax(1, mImage.height() >> level));
+    mMipTickets[level] = QGVTileWorker::shared()->run(
+            [source, size](const QAtomicInt& /*canceled*/) {
+                return source.scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+            },
+            [this, level](const QImage& image) {
+                mMipTickets.remove(level);
+                if (mMips.size() < level) {
+                    mMips.resize(level);
+                }
+                mMips[level - 1] = image;
+                repaint();
+                Q_EMIT imageChanged();
+            });
+}
+
+void QGVImage::resetMips()
+{
+    mMips.clear();
+    if (mMipTickets.isEmpty()) {
+        return;
+    }
+    for (quint64 ticket : mMipTickets) {
+        QGVTileWorker::shared()->cancel(ticket);
+    }
+    mMipTickets.clear();
+}
+
+void QGVImage::requestDecode()
+{
+    if (mEncoded.isEmpty() || !mImage.isNull() || mDecodeTicket != 0) {
+        return;
+    }
+    startDecode();
+}
+
+void QGVImage::startDecode()
+{
+    const QByteArray encoded = mEncoded;
+    mDecodeTicket = QGVTileWorker::shared()->run(
+            [encoded](const QAtomicInt& /*canceled*/) { return QGVTileWorker::decode(encoded); },
+            [this](const QImage& image) {
+                mDecodeTicket = 0;
+                mImage = image;
+                mPixmap = QPixmap();
+                resetMips();
+                repaint();
+                Q_EMIT imageChanged();
+            });
+}
+
+void QGVImage::cancelDecode()
+{
+    if (mDecodeTicket == 0) {
+        return;
+    }
+    QGVTileWorker::shared()->cancel(mDecodeTicket);
+    mDecodeTicket = 0;
 }
 
 void QGVImage::onReplyFinished()
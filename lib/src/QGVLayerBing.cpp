@@ -42,6 +42,9 @@ const QMap<QGV::TilesType, QStringList> URLTemplates = {
 // clang-format on
 }
 
+/*!
+ * Server number selects one of t0, t1 and t2 servers of virtualearth.net.
+ */
 QGVLayerBing::QGVLayerBing(QGV::TilesType type, QLocale locale, int serverNumber)
     : mType(type)
     , mLocale(locale)
@@ -85,6 +88,11 @@ void QGVLayerBing::createName()
     setName("Bing Maps (" + adapter[mType] + " " + mLocale.name() + ")");
 }
 
+int QGVLayerBing::countMirrors() const
+{
+    return (mServerNumber < 0) ? URLTemplates[mType].size() : 1;
+}
+
 int QGVLayerBing::minZoomlevel() const
 {
     return 1;
@@ -96,9 +104,14 @@ int QGVLayerBing::maxZoomlevel() const
 }
 
 QString QGVLayerBing::tilePosToUrl(const QGV::GeoTilePos& tilePos) const
+{
+    return tilePosToMirrorUrl(tilePos, tileMirror(tilePos));
+}
+
+QString QGVLayerBing::tilePosToMirrorUrl(const QGV::GeoTilePos& tilePos, int mirror) const
 {
     const QStringList& list = URLTemplates[mType];
-    QString url = list.value(mServerNumber).toLower();
+    QString url = list.value((mServerNumber < 0) ? mirror : mServerNumber).toLower();
     url.replace("${lcl}", mLocale.name());
     url.replace("${qk}", tilePos.toQuadKey());
     return url;
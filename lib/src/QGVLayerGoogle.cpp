@@ -45,6 +45,9 @@ const QMap<QGV::TilesType, QStringList> URLTemplates = {
 // clang-format on
 }
 
+/*!
+ * Server number selects one of mt servers of given tiles type.
+ */
 QGVLayerGoogle::QGVLayerGoogle(QGV::TilesType type, QLocale locale, int serverNumber)
     : mType(type)
     , mLocale(locale)
@@ -88,6 +91,11 @@ void QGVLayerGoogle::createName()
     setName("Google Maps (" + adapter[mType] + " " + mLocale.name() + ")");
 }
 
+int QGVLayerGoogle::countMirrors() const
+{
+    return (mServerNumber < 0) ? URLTemplates[mType].size() : 1;
+}
+
 int QGVLayerGoogle::minZoomlevel() const
 {
     return 0;
@@ -99,9 +107,14 @@ int QGVLayerGoogle::maxZoomlevel() const
 }
 
 QString QGVLayerGoogle::tilePosToUrl(const QGV::GeoTilePos& tilePos) const
+{
+    return tilePosToMirrorUrl(tilePos, tileMirror(tilePos));
+}
+
+QString QGVLayerGoogle::tilePosToMirrorUrl(const QGV::GeoTilePos& tilePos, int mirror) const
 {
     const QStringList& list = URLTemplates[mType];
-    QString url = list.value(mServerNumber).toLower();
+    QString url = list.value((mServerNumber < 0) ? mirror : mServerNumber).toLower();
     url.replace("${lcl}", mLocale.name());
     url.replace("${z}", QString::number(tilePos.zoom()));
     url.replace("${x}", QString::number(tilePos.pos().x()));
@@ -30,8 +30,12 @@ const QStringList URLTemplates = {
 // clang-format on
 }
 
+/*!
+ * Server number selects one of a, b and c tile servers of openstreetmap.org.
+ */
 QGVLayerOSM::QGVLayerOSM(int serverNumber)
-    : mUrl(URLTemplates.value(serverNumber))
+    : mUrl(URLTemplates.value(qMax(0, serverNumber)))
+    , mMirrors((serverNumber < 0) ? URLTemplates : QStringList{ mUrl })
 {
     setName("OpenStreetMap");
     setDescription("Copyrights ©OpenStreetMap");
@@ -39,6 +43,7 @@ QGVLayerOSM::QGVLayerOSM(int serverNumber)
 
 QGVLayerOSM::QGVLayerOSM(const QString& url)
     : mUrl(url)
+    , mMirrors({ url })
 {
     setName("Custom");
     setDescription("OSM-like map");
@@ -47,6 +52,7 @@ QGVLayerOSM::QGVLayerOSM(const QString& url)
 void QGVLayerOSM::setUrl(const QString& url)
 {
     mUrl = url;
+    mMirrors = QStringList{ url };
 }
 
 QString QGVLayerOSM::getUrl() const
@@ -54,6 +60,11 @@ QString QGVLayerOSM::getUrl() const
     return mUrl;
 }
 
+int QGVLayerOSM::countMirrors() const
+{
+    return mMirrors.size();
+}
+
 int QGVLayerOSM::minZoomlevel() const
 {
     return 0;
@@ -66,7 +77,12 @@ int QGVLayerOSM::maxZoomlevel() const
 
 QString QGVLayerOSM::tilePosToUrl(const QGV::GeoTilePos& tilePos) const
 {
-    QString url = mUrl.toLower();
+    return tilePosToMirrorUrl(tilePos, tileMirror(tilePos));
+}
+
+QString QGVLayerOSM::tilePosToMirrorUrl(const QGV::GeoTilePos& tilePos, int mirror) const
+{
+    QString url = mMirrors.value(mirror, mUrl).toLower();
     url.replace("${z}", QString::number(tilePos.zoom()));
     url.replace("${x}", QString::number(tilePos.pos().x()));
     url.replace("${y}", QString::number(tilePos.pos().y()));
@@ -18,24 +18,454 @@
 
 #include "QGVLayerTiles.h"
 #include "QGVDrawItem.h"
+#include "QGVImage.h"
+#include "QGVLayerTilesComposite.h"
 
+#include <QAtomicInt>
 #include <QtMath>
 
+#include <algorithm>
+
 namespace {
 int minMargin = 1;
 int maxMargin = 3;
 int msAnimationUpdateDelay = 250;
+int msVelocityTimeout = 500;
+double minPrefetchSpeed = 1.0;
+double maxSnapScaleChange = 0.25;
+int msDefaultSettleDelay = 300;
+int msDefaultSettleDeadline = 1000;
+int defaultPrefetchTiles = 2;
+int msDefaultCancelGrace = 3000;
+int msMinRefreshCheck = 1000;
+int msMaxRefreshCheck = 60000;
+QAtomicInt lastLayerId;
+
+/*!
+ * Pending requests of all layers by tile source and tile key. Owner layer requests tile, other
+ * layers of same tile source wait for its result instead of requesting same tile again.
+ */
+struct SharedRequest
+{
+    QGVLayerTiles* owner = nullptr;
+    QList<QGVLayerTiles*> waiters;
+};
+QHash<QPair<QString, quint64>, SharedRequest> sharedRequests;
+}
+
+/*!
+ * Scene item of tile layer in batch paint mode. Finished tiles are not added to the scene,
+ * they are owned by this item and painted from flat array sorted by tile key (and so by zoom).
+ */
+class QGVLayerTilesPainter : public QGVDrawItem
+{
+public:
+    QGVLayerTilesPainter();
+    ~QGVLayerTilesPainter();
+
+    void addTile(const QGV::GeoTilePos& tilePos, QGVImage* image);
+    QGVImage* takeTile(const QGV::GeoTilePos& tilePos);
+
+    QPainterPath projShape() const override;
+    void projPaint(QPainter* painter) override;
+
+protected:
+    void onProjection(QGVMap* geoMap) override;
+
+private:
+    struct Tile
+    {
+        quint64 key;
+        QRectF projRect;
+        QGVImage* image;
+    };
+
+    QVector<Tile>::iterator findTile(quint64 key);
+    QRectF tileRect(quint64 key) const;
+
+private:
+    QVector<Tile> mTiles;
+};
+
+/*!
+ * Painter covers whole world, device cache of such item is huge and is invalidated by any tile.
+ */
+QGVLayerTilesPainter::QGVLayerTilesPainter()
+{
+    setFlag(QGV::ItemFlag::Uncached);
+}
+
+QGVLayerTilesPainter::~QGVLayerTilesPainter()
+{
+    for (const Tile& tile : mTiles) {
+        delete tile.image;
+    }
+}
+
+void QGVLayerTilesPainter::addTile(const QGV::GeoTilePos& tilePos, QGVImage* image)
+{
+    const Tile tile = { tilePos.toKey(), tileRect(tilePos.toKey()), image };
+    auto it = findTile(tile.key);
+    if (it != mTiles.end() && it->key == tile.key) {
+        delete it->image;
+        *it = tile;
+    } else {
+        mTiles.insert(it, tile);
+    }
+    const quint64 key = tile.key;
+    connect(image, &QGVImage::imageChanged, this, [this, key]() { repaint(tileRect(key)); });
+    repaint(tile.projRect);
+}
+
+QGVImage* QGVLayerTilesPainter::takeTile(const QGV::GeoTilePos& tilePos)
+{
+    auto it = findTile(tilePos.toKey());
+    if (it == mTiles.end() || it->key != tilePos.toKey()) {
+        return nullptr;
+    }
+    const Tile tile = *it;
+    mTiles.erase(it);
+    disconnect(tile.image, nullptr, this, nullptr);
+    repaint(tile.projRect);
+    return tile.image;
+}
+
+QPainterPath QGVLayerTilesPainter::projShape() const
+{
+    QPainterPath path;
+    if (getMap() != nullptr) {
+        path.addRect(getMap()->getProjection()->boundaryProjRect());
+    }
+    return path;
+}
+
+void QGVLayerTilesPainter::projPaint(QPainter* painter)
+{
+    const QGVCameraState camera = getMap()->getCamera();
+    const QRectF visibleRect = camera.projRect();
+    for (const Tile& tile : mTiles) {
+        if (tile.projRect.intersects(visibleRect)) {
+            tile.image->paint(painter, tile.projRect, camera);
+        }
+    }
+}
+
+void QGVLayerTilesPainter::onProjection(QGVMap* geoMap)
+{
+    QGVDrawItem::onProjection(geoMap);
+    for (Tile& tile : mTiles) {
+        tile.projRect = tileRect(tile.key);
+    }
+    resetBoundary();
+}
+
+QVector<QGVLayerTilesPainter::Tile>::iterator QGVLayerTilesPainter::findTile(quint64 key)
+{
+    return std::lower_bound(mTiles.begin(), mTiles.end(), key, [](const Tile& tile, quint64 value) {
+        return tile.key < value;
+    });
+}
+
+QRectF QGVLayerTilesPainter::tileRect(quint64 key) const
+{
+    if (getMap() == nullptr) {
+        return {};
+    }
+    return getMap()->getProjection()->geoToProj(QGV::GeoTilePos::fromKey(key).toGeoRect());
 }
 
 QGVLayerTiles::QGVLayerTiles()
+    : mLayerId(lastLayerId.fetchAndAddRelaxed(1) + 1)
+    , mCache(QGVTileCache::shared())
 {
     mCurZoom = -1;
+    mPrefetchTiles = defaultPrefetchTiles;
+    mOverzoom = true;
+    mCoarseLevels = 0;
+    mNoDataZoom = -1;
+    mMissingClock.start();
+    mBatchPaint = false;
+    mCompressedTiles = false;
+    mSnapToZoom = false;
+    mMapState = QGV::MapState::Idle;
+    mSettleDelay = msDefaultSettleDelay;
+    mSettleDeadline = msDefaultSettleDeadline;
+    mSettleTimer.setSingleShot(true);
+    connect(&mSettleTimer, &QTimer::timeout, this, &QGVLayerTiles::onSettled);
+    mCancelGrace = msDefaultCancelGrace;
+    mParkClock.start();
+    mParkTimer.setSingleShot(true);
+    connect(&mParkTimer, &QTimer::timeout, this, &QGVLayerTiles::onParkTimeout);
+    mTileTtl = 0;
+    mRefreshClock.start();
+    connect(&mRefreshTimer, &QTimer::timeout, this, &QGVLayerTiles::onRefreshTimeout);
+    mPainter = nullptr;
+    mComposite = nullptr;
     sendToBack();
 }
 
+QGVLayerTiles::~QGVLayerTiles()
+{
+    releaseShared();
+}
+
+/*!
+ * Worker for tile jobs (decoding, reading, rendering), shared by all layers.
+ */
+QGVTileWorker* QGVLayerTiles::getTileWorker() const
+{
+    return QGVTileWorker::shared();
+}
+
+void QGVLayerTiles::setTileCache(const QSharedPointer<QGVTileCache>& cache)
+{
+    mCache = cache;
+}
+
+QSharedPointer<QGVTileCache> QGVLayerTiles::getTileCache() const
+{
+    return mCache;
+}
+
+/*!
+ * Identifier of tile source, used as key in tile cache.
+ * Default value is unique per layer and never reused (unlike layer address), layers with same tiles
+ * can override it to share cache.
+ */
+QString QGVLayerTiles::getTileSource() const
+{
+    return QString("%1#%2").arg(metaObject()->className()).arg(mLayerId);
+}
+
+/*!
+ * Number of tiles loaded ahead of current view in direction of panning, 0 disables prefetch.
+ */
+void QGVLayerTiles::setPrefetchTiles(int tiles)
+{
+    mPrefetchTiles = qMax(0, tiles);
+}
+
+int QGVLayerTiles::getPrefetchTiles() const
+{
+    return mPrefetchTiles;
+}
+
+/*!
+ * When enabled, scales beyond maxZoomlevel() keep showing tiles of maxZoomlevel() scaled up
+ * instead of stopping tiles processing.
+ */
+void QGVLayerTiles::setOverzoom(bool enabled)
+{
+    mOverzoom = enabled;
+    processCamera();
+}
+
+bool QGVLayerTiles::isOverzoom() const
+{
+    return mOverzoom;
+}
+
+/*!
+ * When set, uncovered areas of view first get parent tile from given number of levels above,
+ * which is replaced by tiles of current zoom level as they arrive. 0 disables coarse tiles.
+ */
+void QGVLayerTiles::setCoarseLevels(int levels)
+{
+    mCoarseLevels = qMax(0, levels);
+}
+
+int QGVLayerTiles::getCoarseLevels() const
+{
+    return mCoarseLevels;
+}
+
+/*!
+ * Adds area where tiles of given zoom range (-1 for unlimited) exist. Without coverage all tiles
+ * are considered existing, tiles outside of coverage are never requested.
+ */
+void QGVLayerTiles::addCoverage(const QGV::GeoRect& geoRect, int fromZoom, int toZoom)
+{
+    mCoverage.append({ geoRect, fromZoom, toZoom });
+}
+
+/*!
+ * Bitmap of tiles without data at given zoom level, bit index is y * 2^zoom + x. Tiles of
+ * this and higher zoom levels inside of marked tiles are never requested.
+ */
+void QGVLayerTiles::setNoDataMap(int zoom, const QBitArray& noData)
+{
+    mNoDataZoom = zoom;
+    mNoData = noData;
+}
+
+void QGVLayerTiles::clearCoverage()
+{
+    mCoverage.clear();
+    mNoDataZoom = -1;
+    mNoData.clear();
+    mMissing.clear();
+}
+
+bool QGVLayerTiles::isTileCovered(const QGV::GeoTilePos& tilePos) const
+{
+    const auto missing = mMissing.constFind(tilePos.toKey());
+    if (missing != mMissing.constEnd() && missing.value() >= 0 && mMissingClock.elapsed() < missing.value()) {
+        return false;
+    }
+    return hasTileData(tilePos);
+}
+
+/*!
+ * Tile is inside of coverage and is not missing forever. Unlike isTileCovered() temporary
+ * negative results (e.g. failed requests) are ignored, such tile is expected to come later.
+ */
+bool QGVLayerTiles::hasTileData(const QGV::GeoTilePos& tilePos) const
+{
+    const auto missing = mMissing.constFind(tilePos.toKey());
+    if (missing != mMissing.constEnd() && missing.value() < 0) {
+        return false;
+    }
+    if (!mNoData.isEmpty() && tilePos.zoom() >= mNoDataZoom) {
+        const QPoint pos = (tilePos.zoom() == mNoDataZoom) ? tilePos.pos() : tilePos.parent(mNoDataZoom).pos();
+        const qint64 index = static_cast<qint64>(pos.y()) * (Q_INT64_C(1) << mNoDataZoom) + pos.x();
+        if (index >= 0 && index < mNoData.size() && mNoData.testBit(static_cast<int>(index))) {
+            return false;
+        }
+    }
+    if (mCoverage.isEmpty()) {
+        return true;
+    }
+    const QGV::GeoRect tileRect = tilePos.toGeoRect();
+    for (const Coverage& coverage : mCoverage) {
+        if (coverage.fromZoom >= 0 && tilePos.zoom() < coverage.fromZoom) {
+            continue;
+        }
+        if (coverage.toZoom >= 0 && tilePos.zoom() > coverage.toZoom) {
+            continue;
+        }
+        if (coverage.geoRect.intersects(tileRect)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*!
+ * In batch paint mode all image tiles are painted by single scene item, so adding or removing
+ * tiles doesn't change scene structures. Tiles which are not QGVImage are still added as items.
+ */
+void QGVLayerTiles::setBatchPaint(bool enabled)
+{
+    if (mBatchPaint == enabled) {
+        return;
+    }
+    mBatchPaint = enabled;
+    resetTiles();
+    if (!mBatchPaint && mPainter != nullptr) {
+        delete mPainter;
+        mPainter = nullptr;
+    }
+}
+
+bool QGVLayerTiles::isBatchPaint() const
+{
+    return mBatchPaint;
+}
+
+/*!
+ * When enabled, camera which becomes idle is slightly rescaled (if needed) to show tiles of
+ * current zoom level in their native size, which allows fast unscaled painting of tiles.
+ */
+void QGVLayerTiles::setSnapToZoom(bool enabled)
+{
+    mSnapToZoom = enabled;
+}
+
+bool QGVLayerTiles::isSnapToZoom() const
+{
+    return mSnapToZoom;
+}
+
+/*!
+ * While user zooms by wheel or drags the map, change of zoom level is postponed until camera
+ * is not changed during settle delay (or map becomes idle). Deadline limits total postponing,
+ * so long interaction still updates tiles from time to time.
+ */
+void QGVLayerTiles::setSettleDelay(int msDelay)
+{
+    mSettleDelay = qMax(0, msDelay);
+}
+
+int QGVLayerTiles::getSettleDelay() const
+{
+    return mSettleDelay;
+}
+
+void QGVLayerTiles::setSettleDeadline(int msDeadline)
+{
+    mSettleDeadline = qMax(0, msDeadline);
+}
+
+int QGVLayerTiles::getSettleDeadline() const
+{
+    return mSettleDeadline;
+}
+
+/*!
+ * Pending requests of tiles which are not needed anymore are not canceled during grace period.
+ * Such request is adopted again if tile becomes needed, otherwise its result goes to tile cache.
+ * Zero cancels requests immediately, as well as missing tile cache.
+ */
+void QGVLayerTiles::setCancelGrace(int msGrace)
+{
+    mCancelGrace = qMax(0, msGrace);
+}
+
+int QGVLayerTiles::getCancelGrace() const
+{
+    return mCancelGrace;
+}
+
+/*!
+ * In compressed mode layers which receive encoded tiles keep them encoded, also in tile cache.
+ * Tile is decoded when painted first time, pixels of coarse tiles are released when they leave
+ * the view.
+ */
+void QGVLayerTiles::setCompressedTiles(bool enabled)
+{
+    mCompressedTiles = enabled;
+}
+
+bool QGVLayerTiles::isCompressedTiles() const
+{
+    return mCompressedTiles;
+}
+
+/*!
+ * Time to live of loaded tiles, 0 for unlimited. Expired tiles are shown while they are revalidated
+ * in background (see revalidate()) and are replaced in place when tile source has new content.
+ */
+void QGVLayerTiles::setTileTtl(int msTtl)
+{
+    mTileTtl = qMax(0, msTtl);
+    if (mTileTtl == 0) {
+        mRefreshTimer.stop();
+        mFetched.clear();
+        return;
+    }
+    mRefreshTimer.start(qMax(msMinRefreshCheck, qMin(msMaxRefreshCheck, mTileTtl / 4)));
+}
+
+int QGVLayerTiles::getTileTtl() const
+{
+    return mTileTtl;
+}
+
 void QGVLayerTiles::onProjection(QGVMap* geoMap)
 {
     QGVLayer::onProjection(geoMap);
+    connect(geoMap, &QGVMap::stateChanged, this, &QGVLayerTiles::onMapState, Qt::UniqueConnection);
+    connect(geoMap, &QGVMap::cameraPlanned, this, &QGVLayerTiles::onCameraPlan, Qt::UniqueConnection);
 }
 
 void QGVLayerTiles::onCamera(const QGVCameraState& oldState, const QGVCameraState& newState)
@@ -57,9 +487,22 @@ void QGVLayerTiles::onCamera(const QGVCameraState& oldState, const QGVCameraStat
     } else {
         mLastAnimation.invalidate();
     }
-    if (needUpdate) {
-        processCamera();
+    if (!needUpdate) {
+        return;
     }
+    const bool interaction = (mMapState == QGV::MapState::Wheel || mMapState == QGV::MapState::Moving);
+    if (interaction && zoomForScale(newState.scale()) != mCurZoom) {
+        if (!mSettleStart.isValid()) {
+            mSettleStart.start();
+        }
+        if (mSettleStart.elapsed() < mSettleDeadline) {
+            mSettleTimer.start(mSettleDelay);
+            return;
+        }
+    }
+    mSettleTimer.stop();
+    mSettleStart.invalidate();
+    processCamera();
 }
 
 void QGVLayerTiles::onUpdate()
@@ -73,31 +516,204 @@ void QGVLayerTiles::onClean()
     QGVLayer::onClean();
     mCurZoom = -1;
     mCurRect = {};
+    mPrefetchRect = {};
+    mVelocity = {};
+    mVelocityTimer.invalidate();
+    mSettleTimer.stop();
+    mSettleStart.invalidate();
+    releaseShared();
     mIndex.clear();
+    mFetched.clear();
+    mRefreshing.clear();
+    mPlanned.clear();
+    mParked.clear();
+    mParkTimer.stop();
     deleteItems();
+    mPainter = nullptr;
 }
 
 void QGVLayerTiles::onTile(const QGV::GeoTilePos& tilePos, QGVDrawItem* tileObj)
 {
-    if (tilePos.zoom() != mCurZoom || !mCurRect.contains(tilePos.pos())) {
+    if (mComposite != nullptr) {
+        mComposite->onLayerTile(this, tilePos, tileObj);
+        return;
+    }
+    mPlanned.remove(tilePos.toKey());
+    mParked.remove(tilePos.toKey());
+    cacheTile(tilePos, tileObj);
+    const auto image = qobject_cast<QGVImage*>(tileObj);
+    for (QGVLayerTiles* waiter : takeWaiters(tilePos)) {
+        if (image != nullptr && !image->getEncoded().isEmpty()) {
+            waiter->onTile(tilePos, waiter->createEncodedTile(tilePos, image->getEncoded()));
+        } else if (image != nullptr && image->isImage()) {
+            waiter->onTile(tilePos, waiter->createTile(tilePos, image->getImage()));
+        } else {
+            waiter->requestTile(tilePos);
+        }
+    }
+    if (!isTileActive(tilePos)) {
         delete tileObj;
         return;
     }
     addTile(tilePos, tileObj);
+    if (mTileTtl > 0) {
+        mFetched.insert(tilePos.toKey(), mRefreshClock.elapsed());
+    }
 
+    if (tilePos.zoom() < mCurZoom) {
+        removeWhenCovered(tilePos);
+        return;
+    }
     removeAllAbove(tilePos);
 
-    const int fromZoom = minZoomlevel();
-    const int toZoom = tilePos.zoom() - 1;
-    for (int zoom = fromZoom; zoom <= toZoom; ++zoom) {
-        for (const QGV::GeoTilePos& below : existingTiles(zoom)) {
-            if (below.contains(tilePos)) {
-                removeWhenCovered(below);
-            }
-        }
+    for (const QGV::GeoTilePos& below : mIndex.ancestors(tilePos)) {
+        removeWhenCovered(below);
+    }
+}
+
+/*!
+ * Negative result for requested tile, such tile is not tracked and not requested again
+ * during given timeout (-1 for forever).
+ */
+void QGVLayerTiles::onTileMissing(const QGV::GeoTilePos& tilePos, int msTimeout)
+{
+    qgvDebug() << "missing tile" << tilePos;
+    if (mComposite != nullptr) {
+        mComposite->onLayerTile(this, tilePos, nullptr);
+        return;
+    }
+    mMissing.insert(tilePos.toKey(), (msTimeout < 0) ? -1 : mMissingClock.elapsed() + msTimeout);
+    mPlanned.remove(tilePos.toKey());
+    mParked.remove(tilePos.toKey());
+    for (QGVLayerTiles* waiter : takeWaiters(tilePos)) {
+        waiter->onTileMissing(tilePos, msTimeout);
+    }
+    if (!isTileExists(tilePos) || isTileFinished(tilePos)) {
+        return;
+    }
+    mIndex.take(tilePos);
+    if (tilePos.zoom() != mCurZoom) {
+        return;
+    }
+    for (const QGV::GeoTilePos& below : mIndex.ancestors(tilePos)) {
+        removeWhenCovered(below);
     }
 }
 
+/*!
+ * Expired tile is unchanged (or can't be revalidated now), it is kept for next time to live.
+ */
+void QGVLayerTiles::onTileValid(const QGV::GeoTilePos& tilePos)
+{
+    mRefreshing.remove(tilePos.toKey());
+    if (isTileFinished(tilePos)) {
+        mFetched.insert(tilePos.toKey(), mRefreshClock.elapsed());
+    }
+}
+
+/*!
+ * New content of expired tile. Image of finished tile is replaced in place, without removing
+ * tile from the scene.
+ */
+void QGVLayerTiles::onTileRefresh(const QGV::GeoTilePos& tilePos, QGVDrawItem* tileObj)
+{
+    onTileValid(tilePos);
+    if (!isTileFinished(tilePos)) {
+        cacheTile(tilePos, tileObj);
+        delete tileObj;
+        return;
+    }
+    const auto current = qobject_cast<QGVImage*>(mIndex.value(tilePos));
+    const auto image = qobject_cast<QGVImage*>(tileObj);
+    if (current == nullptr || image == nullptr) {
+        qgvDebug() << "replace tile" << tilePos;
+        removeTile(tilePos);
+        cacheTile(tilePos, tileObj);
+        addTile(tilePos, tileObj);
+        onTileValid(tilePos);
+        return;
+    }
+    qgvDebug() << "refresh tile" << tilePos;
+    if (!image->getEncoded().isEmpty()) {
+        current->loadEncoded(image->getEncoded());
+    } else {
+        current->loadImage(image->getImage());
+    }
+    cacheTile(tilePos, current);
+    delete tileObj;
+}
+
+/*!
+ * Checks expired tile in tile source, result is passed by onTileValid() or onTileRefresh().
+ * Default implementation considers tile unchanged.
+ */
+void QGVLayerTiles::revalidate(const QGV::GeoTilePos& tilePos)
+{
+    onTileValid(tilePos);
+}
+
+/*!
+ * Request is in flight when it consumes resources already (e.g. network connection), requests
+ * waiting in queue are canceled immediately instead of parking.
+ */
+bool QGVLayerTiles::isRequestInFlight(const QGV::GeoTilePos& /*tilePos*/) const
+{
+    return true;
+}
+
+QGVDrawItem* QGVLayerTiles::createTile(const QGV::GeoTilePos& tilePos, const QImage& image)
+{
+    auto tile = new QGVImage();
+    tile->setGeometry(tilePos.toGeoRect());
+    tile->loadImage(image);
+    return tile;
+}
+
+/*!
+ * Tile of compressed mode, see setCompressedTiles().
+ */
+QGVDrawItem* QGVLayerTiles::createEncodedTile(const QGV::GeoTilePos& tilePos, const QByteArray& rawImage)
+{
+    auto tile = new QGVImage();
+    tile->setGeometry(tilePos.toGeoRect());
+    tile->loadEncoded(rawImage);
+    return tile;
+}
+
+/*!
+ * Tile is visible when it covers part of active rect (without prefetch area), tiles of
+ * lower zoom levels are checked by their area on current zoom level. Member of composite layer
+ * has no camera of its own, it is checked by composite.
+ */
+bool QGVLayerTiles::isTileVisible(const QGV::GeoTilePos& tilePos) const
+{
+    if (mComposite != nullptr) {
+        return mComposite->isTileVisible(tilePos);
+    }
+    if (mCurZoom < 0 || tilePos.zoom() > mCurZoom) {
+        return false;
+    }
+    const int factor = 1 << (mCurZoom - tilePos.zoom());
+    return mCurRect.intersects(QRect(tilePos.pos() * factor, QSize(factor, factor)));
+}
+
+/*!
+ * Distance from tile center to center of active rect, measured in tiles of current zoom level.
+ */
+double QGVLayerTiles::tileDistance(const QGV::GeoTilePos& tilePos) const
+{
+    if (mComposite != nullptr) {
+        return mComposite->tileDistance(tilePos);
+    }
+    if (mCurZoom < 0) {
+        return 0;
+    }
+    const double factor = qPow(2, tilePos.zoom() - mCurZoom);
+    const QPointF center = QRectF(mCurRect).center() * factor;
+    const QPointF tileCenter = QPointF(tilePos.pos()) + QPointF(0.5, 0.5);
+    return qSqrt(qPow(tileCenter.x() - center.x(), 2) + qPow(tileCenter.y() - center.y(), 2)) / factor;
+}
+
 int QGVLayerTiles::scaleToZoom(double scale) const
 {
     const double scaleChange = 1 / scale;
@@ -112,10 +728,11 @@ void QGVLayerTiles::processCamera()
     }
     const QGVProjection* projection = getMap()->getProjection();
     const QGVCameraState camera = getMap()->getCamera();
-    const QRectF areaProjRect = camera.projRect().intersected(projection->boundaryProjRect());
-    const QGV::GeoRect areaGeoRect = projection->projToGeo(areaProjRect);
 
-    int originZoom = scaleToZoom(camera.scale());
+    if (maxZoomlevel() < minZoomlevel()) {
+        return;
+    }
+    int originZoom = zoomForScale(camera.scale());
     int newZoom = qMin(maxZoomlevel(), qMax(minZoomlevel(), originZoom));
     if (newZoom != originZoom) {
         return;
@@ -125,18 +742,22 @@ void QGVLayerTiles::processCamera()
 
     const int margin = (zoomChanged) ? minMargin : maxMargin;
     const int sizePerZoom = static_cast<int>(qPow(2, mCurZoom));
-    const QRect maxRect = QRect(QPoint(0, 0), QPoint(sizePerZoom, sizePerZoom));
-    const QPoint topLeft = QGV::GeoTilePos::geoToTilePos(mCurZoom, areaGeoRect.topLeft()).pos();
-    const QPoint bottomRight = QGV::GeoTilePos::geoToTilePos(mCurZoom, areaGeoRect.bottomRight()).pos();
-    QRect activeRect = QRect(topLeft, bottomRight);
-    activeRect = activeRect.adjusted(-margin, -margin, margin, margin);
-    activeRect = activeRect.intersected(maxRect);
-    const bool rectChanged = (!zoomChanged && (mCurRect != activeRect));
+    const QRect maxRect = QRect(0, 0, sizePerZoom, sizePerZoom);
+    const QRect activeRect = tilesRect(mCurZoom, camera.projRect(), margin);
+    const QRectF boundary = projection->boundaryProjRect();
+    const QPointF tileCenter((camera.projRect().center().x() - boundary.left()) / boundary.width() * sizePerZoom,
+                             (camera.projRect().center().y() - boundary.top()) / boundary.height() * sizePerZoom);
+    updateVelocity(tileCenter, zoomChanged);
+    const QRect activePrefetchRect = prefetchRect(activeRect, maxRect);
+    const bool rectChanged = (!zoomChanged && (mCurRect != activeRect || mPrefetchRect != activePrefetchRect));
     mCurRect = activeRect;
+    mPrefetchRect = activePrefetchRect;
 
     if (!zoomChanged && !rectChanged) {
         return;
     }
+    pruneMissing();
+    releaseOffscreen();
 
     if (zoomChanged) {
         qgvDebug() << "new active zoom" << mCurZoom;
@@ -144,12 +765,12 @@ void QGVLayerTiles::processCamera()
         const int toZoom = maxZoomlevel();
         for (int zoom = fromZoom; zoom <= toZoom; ++zoom) {
             if (zoom == mCurZoom) {
-                for (const QGV::GeoTilePos& current : existingTiles(zoom)) {
+                for (const QGV::GeoTilePos& current : mIndex.tiles(zoom)) {
                     removeAllAbove(current);
                 }
                 continue;
             }
-            for (const QGV::GeoTilePos& nonCurrent : existingTiles(zoom)) {
+            for (const QGV::GeoTilePos& nonCurrent : mIndex.tiles(zoom)) {
                 if (!isTileFinished(nonCurrent)) {
                     qgvDebug() << "cancel non-finished" << nonCurrent;
                     removeTile(nonCurrent);
@@ -165,60 +786,189 @@ void QGVLayerTiles::processCamera()
 
     if (rectChanged) {
         qgvDebug() << "new active rect" << mCurRect.topLeft() << mCurRect.bottomRight();
-        for (const QGV::GeoTilePos& tilePos : existingTiles(mCurZoom)) {
-            if (!mCurRect.contains(tilePos.pos())) {
+        for (const QGV::GeoTilePos& tilePos : mIndex.tiles(mCurZoom)) {
+            if (!isTileActive(tilePos)) {
                 qgvDebug() << "delete out of boundary view" << tilePos;
                 removeTile(tilePos);
             }
         }
+        for (int zoom = minZoomlevel(); zoom < mCurZoom; ++zoom) {
+            for (const QGV::GeoTilePos& tilePos : mIndex.tiles(zoom)) {
+                if (!isTileFinished(tilePos) && !isTileVisible(tilePos)) {
+                    qgvDebug() << "cancel out of boundary coarse" << tilePos;
+                    removeTile(tilePos);
+                }
+            }
+        }
     }
 
     QMultiMap<qreal, QGV::GeoTilePos> missing;
-    for (int x = mCurRect.left(); x < mCurRect.right(); ++x) {
-        for (int y = mCurRect.top(); y < mCurRect.bottom(); ++y) {
+    for (int x = mCurRect.left(); x <= mCurRect.right(); ++x) {
+        for (int y = mCurRect.top(); y <= mCurRect.bottom(); ++y) {
             const auto tilePos = QGV::GeoTilePos(mCurZoom, QPoint(x, y));
-            if (isTileExists(tilePos)) {
+            if (isTileExists(tilePos) || !isTileCovered(tilePos)) {
                 continue;
             }
             qreal radius = qSqrt(qPow(x - mCurRect.center().x(), 2) + qPow(y - mCurRect.center().y(), 2));
             missing.insert(radius, tilePos);
         }
     }
+    if (mCoarseLevels > 0) {
+        const int coarseZoom = qMax(minZoomlevel(), mCurZoom - mCoarseLevels);
+        for (const QGV::GeoTilePos& tilePos : missing) {
+            if (coarseZoom >= mCurZoom || !mIndex.ancestors(tilePos).isEmpty()) {
+                continue;
+            }
+            if (!isTileCovered(tilePos.parent(coarseZoom))) {
+                continue;
+            }
+            qgvDebug() << "coarse tile" << tilePos.parent(coarseZoom) << "for" << tilePos;
+            addTile(tilePos.parent(coarseZoom), nullptr);
+        }
+    }
     for (const QGV::GeoTilePos& tilePos : missing) {
         addTile(tilePos, nullptr);
     }
+
+    QMultiMap<qreal, QGV::GeoTilePos> prefetch;
+    for (int x = mPrefetchRect.left(); x <= mPrefetchRect.right(); ++x) {
+        for (int y = mPrefetchRect.top(); y <= mPrefetchRect.bottom(); ++y) {
+            const auto tilePos = QGV::GeoTilePos(mCurZoom, QPoint(x, y));
+            if (mCurRect.contains(tilePos.pos()) || isTileExists(tilePos) || !isTileCovered(tilePos)) {
+                continue;
+            }
+            qreal radius = qSqrt(qPow(x - mCurRect.center().x(), 2) + qPow(y - mCurRect.center().y(), 2));
+            prefetch.insert(radius, tilePos);
+        }
+    }
+    for (const QGV::GeoTilePos& tilePos : prefetch) {
+        qgvDebug() << "prefetch tile" << tilePos;
+        addTile(tilePos, nullptr);
+    }
 }
 
-void QGVLayerTiles::removeAllAbove(const QGV::GeoTilePos& tilePos)
+/*!
+ * Drops decoded pixels of compressed coarse tiles which are out of active rect. Tiles of current
+ * zoom level outside of active and prefetch rects are removed anyway, tiles inside keep pixels.
+ */
+void QGVLayerTiles::releaseOffscreen()
 {
-    const int fromZoom = tilePos.zoom() + 1;
-    const int toZoom = maxZoomlevel();
-    for (int zoom = fromZoom; zoom <= toZoom; ++zoom) {
-        for (const QGV::GeoTilePos& target : existingTiles(zoom)) {
-            if (!tilePos.contains(target)) {
-                continue;
+    if (!mCompressedTiles) {
+        return;
+    }
+    for (int zoom = minZoomlevel(); zoom < mCurZoom; ++zoom) {
+        for (const QGV::GeoTilePos& tilePos : mIndex.tiles(zoom)) {
+            const auto image = qobject_cast<QGVImage*>(mIndex.value(tilePos));
+            if (image != nullptr && !isTileVisible(tilePos)) {
+                image->releaseImage();
             }
-            qgvDebug() << "remove" << target << "above" << tilePos;
-            removeTile(target);
         }
     }
 }
 
+/*!
+ * Rect of tiles at given zoom level which cover projection area, extended by margin.
+ */
+QRect QGVLayerTiles::tilesRect(int zoom, const QRectF& projRect, int margin) const
+{
+    const QGVProjection* projection = getMap()->getProjection();
+    const QRectF areaProjRect = projRect.intersected(projection->boundaryProjRect());
+    const QGV::GeoRect areaGeoRect = projection->projToGeo(areaProjRect);
+    const int sizePerZoom = static_cast<int>(qPow(2, zoom));
+    const QRect maxRect = QRect(0, 0, sizePerZoom, sizePerZoom);
+    const QPoint topLeft = QGV::GeoTilePos::geoToTilePos(zoom, areaGeoRect.topLeft()).pos();
+    const QPoint bottomRight = QGV::GeoTilePos::geoToTilePos(zoom, areaGeoRect.bottomRight()).pos();
+    const QRect rect = QRect(topLeft, bottomRight).adjusted(-margin, -margin, margin, margin);
+    return rect.intersected(maxRect);
+}
+
+/*!
+ * Pan velocity is measured in tiles per second of current zoom level and smoothed
+ * between camera updates. Long pause between updates means that motion was stopped.
+ */
+void QGVLayerTiles::updateVelocity(const QPointF& tileCenter, bool reset)
+{
+    if (reset || !mVelocityTimer.isValid() || mVelocityTimer.elapsed() > msVelocityTimeout) {
+        mVelocity = {};
+    } else if (mVelocityTimer.elapsed() > 0) {
+        const QPointF velocity = (tileCenter - mLastCenter) * 1000.0 / mVelocityTimer.elapsed();
+        mVelocity = (mVelocity + velocity) / 2.0;
+    } else {
+        return;
+    }
+    mLastCenter = tileCenter;
+    mVelocityTimer.start();
+}
+
+/*!
+ * Prefetch area is extension of active rect in direction of motion. When motion stops or
+ * reverses area changes too, so pending prefetch requests left behind are canceled.
+ */
+QRect QGVLayerTiles::prefetchRect(const QRect& activeRect, const QRect& maxRect) const
+{
+    const int dx = (mVelocity.x() > minPrefetchSpeed) ? 1 : (mVelocity.x() < -minPrefetchSpeed) ? -1 : 0;
+    const int dy = (mVelocity.y() > minPrefetchSpeed) ? 1 : (mVelocity.y() < -minPrefetchSpeed) ? -1 : 0;
+    if (mPrefetchTiles == 0 || (dx == 0 && dy == 0)) {
+        return {};
+    }
+    const QRect rect = activeRect.adjusted(qMin(dx, 0) * mPrefetchTiles,
+                                           qMin(dy, 0) * mPrefetchTiles,
+                                           qMax(dx, 0) * mPrefetchTiles,
+                                           qMax(dy, 0) * mPrefetchTiles);
+    return rect.intersected(maxRect);
+}
+
+bool QGVLayerTiles::isTileActive(const QGV::GeoTilePos& tilePos) const
+{
+    if (tilePos.zoom() < mCurZoom) {
+        return isTileExists(tilePos) && !isTileFinished(tilePos) && isTileVisible(tilePos);
+    }
+    if (tilePos.zoom() != mCurZoom) {
+        return false;
+    }
+    return mCurRect.contains(tilePos.pos()) || mPrefetchRect.contains(tilePos.pos());
+}
+
+/*!
+ * Drops expired negative results, permanent ones are kept.
+ */
+void QGVLayerTiles::pruneMissing()
+{
+    const qint64 now = mMissingClock.elapsed();
+    for (auto it = mMissing.begin(); it != mMissing.end();) {
+        if (it.value() >= 0 && it.value() <= now) {
+            it = mMissing.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void QGVLayerTiles::removeAllAbove(const QGV::GeoTilePos& tilePos)
+{
+    for (const QGV::GeoTilePos& target : mIndex.descendants(tilePos)) {
+        qgvDebug() << "remove" << target << "above" << tilePos;
+        removeTile(target);
+    }
+}
+
+/*!
+ * Tile of lower zoom level is removed when all tiles of current zoom level in its visible part are
+ * loaded, parts outside of active rect or coverage are never requested. Tiles which failed for now
+ * are not counted as loaded, so lower tile is kept as fallback until they are retried.
+ */
 void QGVLayerTiles::removeWhenCovered(const QGV::GeoTilePos& tilePos)
 {
-    const int zoomDelta = mCurZoom - tilePos.zoom() + 1;
-    const int neededCount = static_cast<int>(qPow(2, zoomDelta));
+    const int factor = 1 << (mCurZoom - tilePos.zoom());
+    const QRect coverRect = QRect(tilePos.pos() * factor, QSize(factor, factor)).intersected(mCurRect);
+    const int neededCount = coverRect.width() * coverRect.height();
     int count = neededCount;
-    for (const QGV::GeoTilePos& current : existingTiles(mCurZoom)) {
-        if (!tilePos.contains(current)) {
-            continue;
-        }
-        if (!isTileFinished(current)) {
-            break;
-        }
-        count--;
-        if (count == 0) {
-            break;
+    for (int x = coverRect.left(); x <= coverRect.right(); ++x) {
+        for (int y = coverRect.top(); y <= coverRect.bottom(); ++y) {
+            const auto current = QGV::GeoTilePos(mCurZoom, QPoint(x, y));
+            if (isTileFinished(current) || !hasTileData(current)) {
+                count--;
+            }
         }
     }
     if (count == 0) {
@@ -236,12 +986,35 @@ void QGVLayerTiles::addTile(const QGV::GeoTilePos& tilePos, QGVDrawItem* tileObj
         return;
     }
     if (tileObj == nullptr) {
+        mIndex.insert(tilePos, nullptr);
+        if (mPlanned.remove(tilePos.toKey())) {
+            qgvDebug() << "planned tile" << tilePos;
+            return;
+        }
+        if (mParked.remove(tilePos.toKey())) {
+            qgvDebug() << "parked tile" << tilePos;
+            return;
+        }
+        QGVDrawItem* cached = cachedTile(tilePos);
+        if (cached != nullptr) {
+            qgvDebug() << "cached tile" << tilePos;
+            onTile(tilePos, cached);
+            return;
+        }
         qgvDebug() << "request tile" << tilePos;
-        mIndex[tilePos.zoom()][tilePos] = nullptr;
-        request(tilePos);
+        requestTile(tilePos);
     } else {
         qgvDebug() << "add tile" << tilePos;
-        mIndex[tilePos.zoom()][tilePos] = tileObj;
+        mIndex.insert(tilePos, tileObj);
+        const auto image = qobject_cast<QGVImage*>(tileObj);
+        if (mBatchPaint && image != nullptr) {
+            if (mPainter == nullptr) {
+                mPainter = new QGVLayerTilesPainter();
+                addItem(mPainter);
+            }
+            mPainter->addTile(tilePos, image);
+            return;
+        }
         tileObj->setZValue(static_cast<qint16>(tilePos.zoom()));
         addItem(tileObj);
     }
@@ -249,30 +1022,308 @@ void QGVLayerTiles::addTile(const QGV::GeoTilePos& tilePos, QGVDrawItem* tileObj
 
 void QGVLayerTiles::removeTile(const QGV::GeoTilePos& tilePos)
 {
-    const auto tile = mIndex[tilePos.zoom()].take(tilePos);
+    const auto tile = mIndex.take(tilePos);
     if (tile == nullptr) {
-        qgvDebug() << "cancel tile" << tilePos;
-        cancel(tilePos);
+        releaseRequest(tilePos);
     } else {
         qgvDebug() << "remove tile" << tilePos;
+        mRefreshing.remove(tilePos.toKey());
+        mFetched.remove(tilePos.toKey());
+        if (tile->getParent() == nullptr && mPainter != nullptr) {
+            mPainter->takeTile(tilePos);
+        }
+        cacheTile(tilePos, tile);
         delete tile;
     }
 }
 
+void QGVLayerTiles::releaseRequest(const QGV::GeoTilePos& tilePos)
+{
+    if (mCancelGrace == 0 || mCache.isNull() || !isRequestInFlight(tilePos)) {
+        qgvDebug() << "cancel tile" << tilePos;
+        cancelTile(tilePos);
+        return;
+    }
+    qgvDebug() << "park tile" << tilePos;
+    mParked.insert(tilePos.toKey(), mParkClock.elapsed() + mCancelGrace);
+    if (!mParkTimer.isActive()) {
+        mParkTimer.start(mCancelGrace);
+    }
+}
+
+/*!
+ * Requests tile, or joins pending request of another layer with same tile source.
+ * Layers of composite layer are not shared, their tiles are passed to composite.
+ */
+void QGVLayerTiles::requestTile(const QGV::GeoTilePos& tilePos)
+{
+    if (mComposite == nullptr) {
+        SharedRequest& shared = sharedRequests[qMakePair(getTileSource(), tilePos.toKey())];
+        if (shared.owner != nullptr && shared.owner != this) {
+            if (!shared.waiters.contains(this)) {
+                shared.waiters.append(this);
+            }
+            qgvDebug() << "join shared request" << tilePos;
+            return;
+        }
+        shared.owner = this;
+    }
+    request(tilePos);
+}
+
+/*!
+ * Cancels tile request, shared request is handed over to first waiting layer.
+ */
+void QGVLayerTiles::cancelTile(const QGV::GeoTilePos& tilePos)
+{
+    const auto key = qMakePair(getTileSource(), tilePos.toKey());
+    const auto it = sharedRequests.find(key);
+    if (it != sharedRequests.end()) {
+        if (it->owner != this) {
+            it->waiters.removeAll(this);
+            return;
+        }
+        if (!it->waiters.isEmpty()) {
+            it->owner = it->waiters.takeFirst();
+            it->owner->request(tilePos);
+        } else {
+            sharedRequests.erase(it);
+        }
+    }
+    cancel(tilePos);
+}
+
+QList<QGVLayerTiles*> QGVLayerTiles::takeWaiters(const QGV::GeoTilePos& tilePos)
+{
+    const auto key = qMakePair(getTileSource(), tilePos.toKey());
+    const auto it = sharedRequests.find(key);
+    if (it == sharedRequests.end() || it->owner != this) {
+        return {};
+    }
+    const QList<QGVLayerTiles*> waiters = it->waiters;
+    sharedRequests.erase(it);
+    return waiters;
+}
+
+void QGVLayerTiles::releaseShared()
+{
+    QList<QPair<QGVLayerTiles*, QGV::GeoTilePos>> handovers;
+    for (auto it = sharedRequests.begin(); it != sharedRequests.end();) {
+        it->waiters.removeAll(this);
+        if (it->owner != this) {
+            ++it;
+            continue;
+        }
+        if (it->waiters.isEmpty()) {
+            it = sharedRequests.erase(it);
+            continue;
+        }
+        it->owner = it->waiters.takeFirst();
+        handovers.append(qMakePair(it->owner, QGV::GeoTilePos::fromKey(it.key().second)));
+        ++it;
+    }
+    for (const auto& handover : handovers) {
+        handover.first->request(handover.second);
+    }
+}
+
 bool QGVLayerTiles::isTileExists(const QGV::GeoTilePos& tilePos) const
 {
-    return mIndex[tilePos.zoom()].contains(tilePos);
+    return mIndex.contains(tilePos);
 }
 
 bool QGVLayerTiles::isTileFinished(const QGV::GeoTilePos& tilePos) const
 {
-    if (!isTileExists(tilePos)) {
-        return false;
+    return mIndex.isFinished(tilePos);
+}
+
+/*!
+ * Tile of compressed mode is cached encoded, so it costs its data size only.
+ */
+void QGVLayerTiles::cacheTile(const QGV::GeoTilePos& tilePos, QGVDrawItem* tileObj)
+{
+    const auto image = qobject_cast<QGVImage*>(tileObj);
+    if (mCache.isNull() || image == nullptr || !image->isImage()) {
+        return;
     }
-    return mIndex[tilePos.zoom()][tilePos] != nullptr;
+    if (!image->getEncoded().isEmpty()) {
+        mCache->insertEncoded(getTileSource(), tilePos, image->getEncoded());
+        return;
+    }
+    mCache->insert(getTileSource(), tilePos, image->getImage());
 }
 
-QList<QGV::GeoTilePos> QGVLayerTiles::existingTiles(int zoom) const
+QGVDrawItem* QGVLayerTiles::cachedTile(const QGV::GeoTilePos& tilePos)
 {
-    return mIndex[zoom].keys();
+    if (mCache.isNull()) {
+        return nullptr;
+    }
+    const QImage image = mCache->find(getTileSource(), tilePos);
+    if (!image.isNull()) {
+        return createTile(tilePos, image);
+    }
+    const QByteArray rawImage = mCache->findEncoded(getTileSource(), tilePos);
+    if (!rawImage.isEmpty()) {
+        return createEncodedTile(tilePos, rawImage);
+    }
+    return nullptr;
+}
+
+/*!
+ * Removes all tiles and processes camera again, finished tiles are restored from tile cache.
+ */
+void QGVLayerTiles::resetTiles()
+{
+    for (int zoom = minZoomlevel(); zoom <= maxZoomlevel(); ++zoom) {
+        for (const QGV::GeoTilePos& tilePos : mIndex.tiles(zoom)) {
+            removeTile(tilePos);
+        }
+    }
+    mCurZoom = -1;
+    mCurRect = {};
+    mPrefetchRect = {};
+    processCamera();
+}
+
+void QGVLayerTiles::onMapState(QGV::MapState state)
+{
+    mMapState = state;
+    if (state == QGV::MapState::Idle && mSettleTimer.isActive()) {
+        onSettled();
+    }
+    if (!mSnapToZoom || state != QGV::MapState::Idle || getMap() == nullptr || mCurZoom < 0) {
+        return;
+    }
+    const QGVCameraState camera = getMap()->getCamera();
+    if (!qFuzzyIsNull(camera.azimuth())) {
+        return;
+    }
+    int tileSize = 0;
+    for (const QGV::GeoTilePos& tilePos : mIndex.tiles(mCurZoom)) {
+        const auto image = qobject_cast<QGVImage*>(mIndex.value(tilePos));
+        if (image != nullptr && image->isImage()) {
+            tileSize = image->getImageSize().width();
+            break;
+        }
+    }
+    if (tileSize == 0) {
+        return;
+    }
+    const double worldSize = getMap()->getProjection()->boundaryProjRect().width();
+    const double exactScale = tileSize * qPow(2, mCurZoom) / worldSize;
+    const double change = qAbs(exactScale / camera.scale() - 1.0);
+    if (change > maxSnapScaleChange || qFuzzyIsNull(change)) {
+        return;
+    }
+    qgvDebug() << "snap scale" << camera.scale() << "to" << exactScale;
+    getMap()->cameraTo(QGVCameraActions(getMap()).scaleTo(exactScale));
+}
+
+/*!
+ * Tiles of planned camera states are requested ahead of animation and go to tile cache when
+ * loaded. Requests which are still pending when camera reaches them become regular tiles,
+ * the rest is canceled when plan is changed or animation is finished.
+ */
+void QGVLayerTiles::onCameraPlan(const QList<QGVCameraState>& states)
+{
+    QList<QGV::GeoTilePos> planned;
+    const bool canPlan = (getMap() != nullptr && isVisible() && mComposite == nullptr);
+    for (const QGVCameraState& state : states) {
+        if (!canPlan || maxZoomlevel() < minZoomlevel()) {
+            break;
+        }
+        const int zoom = zoomForScale(state.scale());
+        if (zoom < minZoomlevel() || zoom > maxZoomlevel()) {
+            continue;
+        }
+        const QRect rect = tilesRect(zoom, state.projRect(), minMargin);
+        for (int x = rect.left(); x <= rect.right(); ++x) {
+            for (int y = rect.top(); y <= rect.bottom(); ++y) {
+                const auto tilePos = QGV::GeoTilePos(zoom, QPoint(x, y));
+                if (isTileExists(tilePos) || !isTileCovered(tilePos)) {
+                    continue;
+                }
+                planned.append(tilePos);
+            }
+        }
+    }
+    QSet<quint64> plannedKeys;
+    for (const QGV::GeoTilePos& tilePos : planned) {
+        plannedKeys.insert(tilePos.toKey());
+    }
+    for (quint64 key : mPlanned.values()) {
+        if (!plannedKeys.contains(key)) {
+            mPlanned.remove(key);
+            releaseRequest(QGV::GeoTilePos::fromKey(key));
+        }
+    }
+    for (const QGV::GeoTilePos& tilePos : planned) {
+        if (mPlanned.contains(tilePos.toKey())) {
+            continue;
+        }
+        if (mParked.remove(tilePos.toKey())) {
+            mPlanned.insert(tilePos.toKey());
+            continue;
+        }
+        if (!mCache.isNull() && mCache->contains(getTileSource(), tilePos)) {
+            continue;
+        }
+        qgvDebug() << "request planned tile" << tilePos;
+        mPlanned.insert(tilePos.toKey());
+        requestTile(tilePos);
+    }
+}
+
+void QGVLayerTiles::onSettled()
+{
+    mSettleTimer.stop();
+    mSettleStart.invalidate();
+    processCamera();
+}
+
+void QGVLayerTiles::onParkTimeout()
+{
+    const qint64 now = mParkClock.elapsed();
+    qint64 next = -1;
+    for (quint64 key : mParked.keys()) {
+        const qint64 deadline = mParked.value(key);
+        if (deadline > now) {
+            next = (next < 0) ? deadline : qMin(next, deadline);
+            continue;
+        }
+        qgvDebug() << "cancel parked tile" << QGV::GeoTilePos::fromKey(key);
+        mParked.remove(key);
+        cancelTile(QGV::GeoTilePos::fromKey(key));
+    }
+    if (next >= 0) {
+        mParkTimer.start(static_cast<int>(next - now));
+    }
+}
+
+void QGVLayerTiles::onRefreshTimeout()
+{
+    if (getMap() == nullptr || !isVisible() || mTileTtl == 0 || maxZoomlevel() < minZoomlevel()) {
+        return;
+    }
+    const qint64 now = mRefreshClock.elapsed();
+    for (int zoom = minZoomlevel(); zoom <= maxZoomlevel(); ++zoom) {
+        for (const QGV::GeoTilePos& tilePos : mIndex.tiles(zoom)) {
+            const quint64 key = tilePos.toKey();
+            if (!isTileFinished(tilePos) || mRefreshing.contains(key) || now - mFetched.value(key, now) < mTileTtl) {
+                continue;
+            }
+            qgvDebug() << "revalidate tile" << tilePos;
+            mRefreshing.insert(key);
+            revalidate(tilePos);
+        }
+    }
+}
+
+int QGVLayerTiles::zoomForScale(double scale) const
+{
+    const int zoom = scaleToZoom(scale);
+    if (mOverzoom && zoom > maxZoomlevel()) {
+        return maxZoomlevel();
+    }
+    return zoom;
 }
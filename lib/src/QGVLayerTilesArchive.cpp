@@ -0,0 +1,61 @@
+/***************************************************************************
+ * QGeoView is a Qt / C ++ widget for visualizing geographic data.
+ * Copyright (C) 2018-2020 Andrey Yaroshenko.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see https://www.gnu.org/licenses.
+ ****************************************************************************/
+
+#include "QGVLayerTilesArchive.h"
+
+QGVLayerTilesArchive::QGVLayerTilesArchive(const QString& fileName)
+    : mArchive(new QGVTileArchive(fileName))
+{
+    setName("Archive");
+    setDescription("Tiles archive");
+}
+
+QSharedPointer<QGVTileArchive> QGVLayerTilesArchive::getArchive() const
+{
+    return mArchive;
+}
+
+QString QGVLayerTilesArchive::getTileSource() const
+{
+    return QString("%1/%2").arg(metaObject()->className()).arg(mArchive->getFileName());
+}
+
+int QGVLayerTilesArchive::minZoomlevel() const
+{
+    return mArchive->minZoomlevel();
+}
+
+int QGVLayerTilesArchive::maxZoomlevel() const
+{
+    return mArchive->maxZoomlevel();
+}
+
+/*!
+ * Job holds archive, so mapped data stays valid even if layer is deleted meanwhile.
+ */
+QGVTileWorker::Job QGVLayerTilesArchive::createJob(const QGV::GeoTilePos& tilePos) const
+{
+    const QSharedPointer<QGVTileArchive> archive = mArchive;
+    return [archive, tilePos](const QAtomicInt& canceled) -> QImage {
+        const QByteArray rawData = archive->find(tilePos);
+        if (rawData.isEmpty() || canceled.load() != 0) {
+            return QImage();
+        }
+        return QGVTileWorker::decode(rawData);
+    };
+}
@@ -0,0 +1,80 @@
+/***************************************************************************
+ * QGeoView is a Qt / C ++ widget for visualizing geographic data.
+ * Copyright (C) 2018-2020 Andrey Yaroshenko.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see https://www.gnu.org/licenses.
+ ****************************************************************************/
+
+#include "QGVLayerTilesAsync.h"
+
+QGVLayerTilesAsync::QGVLayerTilesAsync()
+{}
+
+QGVLayerTilesAsync::~QGVLayerTilesAsync()
+{
+    cancelAll();
+}
+
+int QGVLayerTilesAsync::countJobs() const
+{
+    return mJobs.count();
+}
+
+void QGVLayerTilesAsync::onClean()
+{
+    cancelAll();
+    QGVLayerTiles::onClean();
+}
+
+void QGVLayerTilesAsync::request(const QGV::GeoTilePos& tilePos)
+{
+    cancel(tilePos);
+    mJobs[tilePos] = getTileWorker()->run(createJob(tilePos), [this, tilePos](const QImage& image) {
+        onJobFinished(tilePos, image);
+    });
+}
+
+void QGVLayerTilesAsync::cancel(const QGV::GeoTilePos& tilePos)
+{
+    if (!mJobs.contains(tilePos)) {
+        return;
+    }
+    getTileWorker()->cancel(mJobs.take(tilePos));
+}
+
+/*!
+ * Jobs waiting in the tile worker cost nothing and are canceled instead of parking.
+ */
+bool QGVLayerTilesAsync::isRequestInFlight(const QGV::GeoTilePos& tilePos) const
+{
+    return mJobs.contains(tilePos) && !getTileWorker()->isWaiting(mJobs.value(tilePos));
+}
+
+void QGVLayerTilesAsync::onJobFinished(const QGV::GeoTilePos& tilePos, const QImage& image)
+{
+    mJobs.remove(tilePos);
+    if (image.isNull()) {
+        onTileMissing(tilePos);
+        return;
+    }
+    onTile(tilePos, createTile(tilePos, image));
+}
+
+void QGVLayerTilesAsync::cancelAll()
+{
+    for (quint64 ticket : mJobs) {
+        getTileWorker()->cancel(ticket);
+    }
+    mJobs.clear();
+}
@@ -0,0 +1,227 @@
+/***************************************************************************
+ * QGeoView is a Qt / C ++ widget for visualizing geographic data.
+ * Copyright (C) 2018-2020 Andrey Yaroshenko.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see https://www.gnu.org/licenses.
+ ****************************************************************************/
+
+#include "QGVLayerTilesComposite.h"
+#include "QGVImage.h"
+
+#include <QPainter>
+#include <QStringList>
+
+QGVLayerTilesComposite::QGVLayerTilesComposite()
+{}
+
+QGVLayerTilesComposite::~QGVLayerTilesComposite()
+{
+    for (quint64 ticket : mBlending) {
+        getTileWorker()->cancel(ticket);
+    }
+    qDeleteAll(mLayers);
+}
+
+void QGVLayerTilesComposite::addLayer(QGVLayerTiles* layer)
+{
+    Q_ASSERT(layer);
+    Q_ASSERT(layer->getParent() == nullptr);
+    layer->mComposite = this;
+    mLayers.append(layer);
+    if (getMap() != nullptr) {
+        layer->onProjection(getMap());
+    }
+}
+
+int QGVLayerTilesComposite::countLayers() const
+{
+    return mLayers.count();
+}
+
+QGVLayerTiles* QGVLayerTilesComposite::getLayer(int index) const
+{
+    return mLayers.at(index);
+}
+
+QString QGVLayerTilesComposite::getTileSource() const
+{
+    QStringList sources;
+    for (const QGVLayerTiles* layer : mLayers) {
+        sources.append(QString("%1@%2").arg(layer->getTileSource()).arg(layer->getOpacity()));
+    }
+    return QString("%1(%2)").arg(metaObject()->className()).arg(sources.join("+"));
+}
+
+void QGVLayerTilesComposite::onProjection(QGVMap* geoMap)
+{
+    QGVLayerTiles::onProjection(geoMap);
+    for (QGVLayerTiles* layer : mLayers) {
+        layer->onProjection(geoMap);
+    }
+}
+
+void QGVLayerTilesComposite::onClean()
+{
+    for (quint64 ticket : mBlending) {
+        getTileWorker()->cancel(ticket);
+    }
+    mBlending.clear();
+    for (const QGV::GeoTilePos& tilePos : mParts.keys()) {
+        cancel(tilePos);
+    }
+    for (QGVLayerTiles* layer : mLayers) {
+        layer->onClean();
+    }
+    QGVLayerTiles::onClean();
+}
+
+int QGVLayerTilesComposite::minZoomlevel() const
+{
+    int zoom = 0;
+    for (const QGVLayerTiles* layer : mLayers) {
+        zoom = qMax(zoom, layer->minZoomlevel());
+    }
+    return zoom;
+}
+
+int QGVLayerTilesComposite::maxZoomlevel() const
+{
+    if (mLayers.isEmpty()) {
+        return -1;
+    }
+    int zoom = mLayers.first()->maxZoomlevel();
+    for (const QGVLayerTiles* layer : mLayers) {
+        zoom = qMin(zoom, layer->maxZoomlevel());
+    }
+    return zoom;
+}
+
+void QGVLayerTilesComposite::request(const QGV::GeoTilePos& tilePos)
+{
+    Parts& parts = mParts[tilePos];
+    parts.images = QVector<QImage>(mLayers.count());
+    parts.received = QBitArray(mLayers.count());
+    for (QGVLayerTiles* layer : mLayers) {
+        if (!layer->isTileCovered(tilePos)) {
+            onLayerImage(layer, tilePos, {});
+            continue;
+        }
+        layer->request(tilePos);
+    }
+}
+
+void QGVLayerTilesComposite::cancel(const QGV::GeoTilePos& tilePos)
+{
+    if (mParts.contains(tilePos)) {
+        const Parts parts = mParts.take(tilePos);
+        for (int i = 0; i < mLayers.count(); ++i) {
+            if (!parts.received.testBit(i)) {
+                mLayers[i]->cancel(tilePos);
+            }
+        }
+    }
+    if (mBlending.contains(tilePos)) {
+        getTileWorker()->cancel(mBlending.take(tilePos));
+    }
+}
+
+bool QGVLayerTilesComposite::isRequestInFlight(const QGV::GeoTilePos& tilePos) const
+{
+    if (mBlending.contains(tilePos)) {
+        return true;
+    }
+    const auto parts = mParts.constFind(tilePos);
+    if (parts == mParts.constEnd()) {
+        return false;
+    }
+    for (int i = 0; i < mLayers.count(); ++i) {
+        if (!parts->received.testBit(i) && mLayers[i]->isRequestInFlight(tilePos)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void QGVLayerTilesComposite::onLayerTile(QGVLayerTiles* layer, const QGV::GeoTilePos& tilePos, QGVDrawItem* tileObj)
+{
+    const auto image = qobject_cast<QGVImage*>(tileObj);
+    if (tileObj != nullptr && image == nullptr) {
+        qgvWarning() << "composite member" << layer->getTileSource() << "has non-image tile" << tilePos;
+    }
+    onLayerImage(layer, tilePos, (image != nullptr) ? image->getImage() : QImage());
+    delete tileObj;
+}
+
+void QGVLayerTilesComposite::onLayerImage(QGVLayerTiles* layer, const QGV::GeoTilePos& tilePos, const QImage& image)
+{
+    const int index = mLayers.indexOf(layer);
+    if (index < 0 || !mParts.contains(tilePos)) {
+        return;
+    }
+    Parts& parts = mParts[tilePos];
+    parts.images[index] = image;
+    parts.received.setBit(index);
+    if (parts.received.count(true) == mLayers.count()) {
+        blendTile(tilePos);
+    }
+}
+
+void QGVLayerTilesComposite::blendTile(const QGV::GeoTilePos& tilePos)
+{
+    const Parts parts = mParts.take(tilePos);
+    QVector<double> opacities;
+    bool isEmpty = true;
+    for (int i = 0; i < mLayers.count(); ++i) {
+        opacities.append(mLayers[i]->getOpacity());
+        isEmpty = isEmpty && parts.images[i].isNull();
+    }
+    if (isEmpty) {
+        onTileMissing(tilePos);
+        return;
+    }
+    const QVector<QImage> images = parts.images;
+    mBlending[tilePos] = getTileWorker()->run(
+            [images, opacities](const QAtomicInt& canceled) -> QImage {
+                QSize size;
+                for (const QImage& image : images) {
+                    size = size.expandedTo(image.size());
+                }
+                QImage result(size, QImage::Format_ARGB32_Premultiplied);
+                result.fill(Qt::transparent);
+                QPainter painter(&result);
+                painter.setRenderHint(QPainter::SmoothPixmapTransform);
+                for (int i = 0; i < images.count(); ++i) {
+                    if (canceled.load() != 0) {
+                        return QImage();
+                    }
+                    if (images[i].isNull()) {
+                        continue;
+                    }
+                    painter.setOpacity(opacities[i]);
+                    painter.drawImage(result.rect(), images[i]);
+                }
+                painter.end();
+                return result;
+            },
+            [this, tilePos](const QImage& image) { onTileBlended(tilePos, image); });
+}
+
+void QGVLayerTilesComposite::onTileBlended(const QGV::GeoTilePos& tilePos, const QImage& image)
+{
+    mBlending.remove(tilePos);
+    if (image.isNull()) {
+        return;
+    }
+    onTile(tilePos, createTile(tilePos, image));
+}
@@ -0,0 +1,82 @@
+/***************************************************************************
+ * QGeoView is a Qt / C ++ widget for visualizing geographic data.
+ * Copyright (C) 2018-2020 Andrey Yaroshenko.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see https://www.gnu.org/licenses.
+ ****************************************************************************/
+
+#include "QGVLayerTilesLocal.h"
+
+#include <QFile>
+
+QGVLayerTilesLocal::QGVLayerTilesLocal(const QString& pathTemplate, int minZoom, int maxZoom)
+    : mPathTemplate(pathTemplate)
+    , mMinZoom(minZoom)
+    , mMaxZoom(maxZoom)
+{
+    setName("Local");
+    setDescription("Local tiles");
+}
+
+void QGVLayerTilesLocal::setPathTemplate(const QString& pathTemplate)
+{
+    mPathTemplate = pathTemplate;
+}
+
+QString QGVLayerTilesLocal::getPathTemplate() const
+{
+    return mPathTemplate;
+}
+
+QString QGVLayerTilesLocal::getTileSource() const
+{
+    return QString("%1/%2").arg(metaObject()->className()).arg(mPathTemplate);
+}
+
+int QGVLayerTilesLocal::minZoomlevel() const
+{
+    return mMinZoom;
+}
+
+int QGVLayerTilesLocal::maxZoomlevel() const
+{
+    return mMaxZoom;
+}
+
+QGVTileWorker::Job QGVLayerTilesLocal::createJob(const QGV::GeoTilePos& tilePos) const
+{
+    const QString path = tilePosToPath(tilePos);
+    return [path](const QAtomicInt& canceled) -> QImage {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            return QImage();
+        }
+        const QByteArray rawData = file.readAll();
+        if (canceled.load() != 0) {
+            return QImage();
+        }
+        return QGVTileWorker::decode(rawData);
+    };
+}
+
+QString QGVLayerTilesLocal::tilePosToPath(const QGV::GeoTilePos& tilePos) const
+{
+    const int rows = 1 << tilePos.zoom();
+    QString path = mPathTemplate;
+    path.replace("${z}", QString::number(tilePos.zoom()));
+    path.replace("${x}", QString::number(tilePos.pos().x()));
+    path.replace("${-y}", QString::number(rows - 1 - tilePos.pos().y()));
+    path.replace("${y}", QString::number(tilePos.pos().y()));
+    return path;
+}
@@ -18,28 +18,348 @@
 
 #include "QGVLayerTilesOnline.h"
 #include "QGVImage.h"
+#include "QGVTileStore.h"
+
+#include <QCoreApplication>
+#include <QPointer>
+#include <QTimer>
+
+#include <algorithm>
+#include <random>
+
+namespace {
+int maxRequestsPerHost = 6;
+int defaultMaxRequests = 12;
+int defaultMaxRetries = 3;
+int msDefaultRetryDelay = 1000;
+int msMaxRetryDelay = 60000;
+int msDefaultFailureTimeout = 300000;
+double defaultHedgeQuantile = 0.95;
+int minLatencySamples = 20;
+int maxLatencySamples = 100;
+QHash<QString, int> hostRequests;
+QList<QGVLayerTilesOnline*> onlineLayers;
+
+QGVTileFetcher* tileFetcher()
+{
+    static QPointer<QGVTileFetcher> fetcher;
+    if (QGV::getTileFetcher() != nullptr) {
+        return QGV::getTileFetcher();
+    }
+    if (fetcher.isNull()) {
+        fetcher = new QGVTileFetcher(QCoreApplication::instance());
+    }
+    return fetcher;
+}
+}
+
+QGVLayerTilesOnline::QGVLayerTilesOnline()
+    : mMaxRequests(defaultMaxRequests)
+    , mMaxRetries(defaultMaxRetries)
+    , mRetryDelay(msDefaultRetryDelay)
+    , mFailureTimeout(msDefaultFailureTimeout)
+    , mHedgeQuantile(defaultHedgeQuantile)
+    , mLatencyIndex(0)
+    , mSchedulePending(false)
+{
+    mClock.start();
+    resetStatistics();
+    onlineLayers.append(this);
+}
 
 QGVLayerTilesOnline::~QGVLayerTilesOnline()
 {
-    qDeleteAll(mRequest);
+    onlineLayers.removeOne(this);
+    for (const QGV::GeoTilePos& tilePos : mRequest.keys()) {
+        removeReply(tilePos);
+    }
+    for (quint64 ticket : mDecoding) {
+        getTileWorker()->cancel(ticket);
+    }
+}
+
+/*!
+ * Tile source is identified by url of fixed tile (with zoom, x and y all different), so layers with
+ * same url template share tiles and renaming of layer doesn't change it.
+ */
+QString QGVLayerTilesOnline::getTileSource() const
+{
+    return tilePosToMirrorUrl(QGV::GeoTilePos(3, QPoint(1, 2)), 0);
+}
+
+/*!
+ * Maximum number of simultaneous network requests of this layer, other tiles wait in queue.
+ */
+void QGVLayerTilesOnline::setMaxRequests(int requests)
+{
+    mMaxRequests = qMax(1, requests);
+    scheduleLater();
+}
+
+int QGVLayerTilesOnline::getMaxRequests() const
+{
+    return mMaxRequests;
 }
 
-void QGVLayerTilesOnline::onProjection(QGVMap* geoMap)
+int QGVLayerTilesOnline::countQueued() const
 {
-    Q_ASSERT(QGV::getNetworkManager());
-    QGVLayerTiles::onProjection(geoMap);
-    connect(QGV::getNetworkManager(), &QNetworkAccessManager::finished, this, &QGVLayerTilesOnline::onReplyFinished);
+    return mQueue.count();
+}
+
+int QGVLayerTilesOnline::countRequests() const
+{
+    return mRequest.count();
+}
+
+/*!
+ * Number of repeated requests for failed tile, after that tile is considered missing
+ * for failure timeout.
+ */
+void QGVLayerTilesOnline::setMaxRetries(int retries)
+{
+    mMaxRetries = qMax(0, retries);
+}
+
+int QGVLayerTilesOnline::getMaxRetries() const
+{
+    return mMaxRetries;
+}
+
+/*!
+ * Delay before first retry, each next retry doubles it (with random jitter).
+ */
+void QGVLayerTilesOnline::setRetryDelay(int msDelay)
+{
+    mRetryDelay = qMax(0, msDelay);
+}
+
+int QGVLayerTilesOnline::getRetryDelay() const
+{
+    return mRetryDelay;
+}
+
+void QGVLayerTilesOnline::setFailureTimeout(int msTimeout)
+{
+    mFailureTimeout = msTimeout;
+}
+
+int QGVLayerTilesOnline::getFailureTimeout() const
+{
+    return mFailureTimeout;
+}
+
+/*!
+ * When request of tile takes longer than given quantile of recent request latencies, duplicate
+ * request is sent to another mirror and the slower one is canceled. 0 disables hedged requests,
+ * they are never sent for layers with single mirror.
+ */
+void QGVLayerTilesOnline::setHedgeQuantile(double quantile)
+{
+    mHedgeQuantile = qMax(0.0, qMin(1.0, quantile));
+}
+
+double QGVLayerTilesOnline::getHedgeQuantile() const
+{
+    return mHedgeQuantile;
+}
+
+QGVLayerTilesOnline::Statistics QGVLayerTilesOnline::getStatistics() const
+{
+    return mStatistics;
+}
+
+void QGVLayerTilesOnline::resetStatistics()
+{
+    mStatistics = {};
+}
+
+/*!
+ * Maximum number of simultaneous network requests to one host, shared by all online layers.
+ */
+void QGVLayerTilesOnline::setMaxRequestsPerHost(int requests)
+{
+    maxRequestsPerHost = qMax(1, requests);
+    for (QGVLayerTilesOnline* layer : onlineLayers) {
+        layer->scheduleLater();
+    }
+}
+
+int QGVLayerTilesOnline::getMaxRequestsPerHost()
+{
+    return maxRequestsPerHost;
+}
+
+QString QGVLayerTilesOnline::tilePosToMirrorUrl(const QGV::GeoTilePos& tilePos, int /*mirror*/) const
+{
+    return tilePosToUrl(tilePos);
+}
+
+/*!
+ * Number of equivalent servers of tile source, urls of them are provided by tilePosToMirrorUrl().
+ * Built-in layers take server number in constructor: -1 (default) uses all servers of tile source,
+ * other value pins layer to one server.
+ */
+int QGVLayerTilesOnline::countMirrors() const
+{
+    return 1;
+}
+
+/*!
+ * Mirror is selected by tile key, so same tile is always requested from same server (and
+ * can be reused from HTTP caches) while requests of neighbour tiles are spread across servers.
+ */
+int QGVLayerTilesOnline::tileMirror(const QGV::GeoTilePos& tilePos) const
+{
+    const int count = qMax(1, countMirrors());
+    return static_cast<int>(tilePos.toKey() % static_cast<quint64>(count));
 }
 
 void QGVLayerTilesOnline::onClean()
 {
-    Q_ASSERT(QGV::getNetworkManager());
-    disconnect(QGV::getNetworkManager(), 0, this, 0);
+    for (const QGV::GeoTilePos& tilePos : mRequest.keys()) {
+        removeReply(tilePos);
+    }
+    for (quint64 ticket : mDecoding) {
+        getTileWorker()->cancel(ticket);
+    }
+    mDecoding.clear();
+    mQueue.clear();
+    mRetrying.clear();
+    mRevalidating.clear();
+    mValidators.clear();
+    mFailures.clear();
+    QGVLayerTiles::onClean();
 }
 
 void QGVLayerTilesOnline::request(const QGV::GeoTilePos& tilePos)
 {
-    const QUrl url(tilePosToUrl(tilePos));
+    if (mRevalidating.contains(tilePos.toKey())) {
+        cancel(tilePos);
+    }
+    QGVTileStore* store = QGV::getTileStore();
+    if (store != nullptr && getTileTtl() == 0) {
+        const QByteArray rawImage = store->find(getTileSource(), tilePos);
+        if (!rawImage.isEmpty()) {
+            qgvDebug() << "stored" << tilePos;
+            decodeTile(tilePos, tilePosToMirrorUrl(tilePos, tileMirror(tilePos)), rawImage);
+            return;
+        }
+    }
+    mQueue.append(tilePos.toKey());
+    scheduleLater();
+}
+
+void QGVLayerTilesOnline::cancel(const QGV::GeoTilePos& tilePos)
+{
+    mQueue.removeOne(tilePos.toKey());
+    mRetrying.remove(tilePos.toKey());
+    mRevalidating.remove(tilePos.toKey());
+    removeReply(tilePos);
+    removeDecoding(tilePos);
+}
+
+bool QGVLayerTilesOnline::isRequestInFlight(const QGV::GeoTilePos& tilePos) const
+{
+    return mRequest.contains(tilePos) || mDecoding.contains(tilePos);
+}
+
+/*!
+ * Expired tile is requested again with validators of its last response (ETag and Last-Modified),
+ * so server can answer by "304 Not Modified" without content.
+ */
+void QGVLayerTilesOnline::revalidate(const QGV::GeoTilePos& tilePos)
+{
+    if (mRevalidating.contains(tilePos.toKey())) {
+        return;
+    }
+    if (mRequest.contains(tilePos) || mQueue.contains(tilePos.toKey())) {
+        onTileValid(tilePos);
+        return;
+    }
+    mRevalidating.insert(tilePos.toKey());
+    mQueue.append(tilePos.toKey());
+    scheduleLater();
+}
+
+/*!
+ * Requests are sent from queue in order of priority once per event loop iteration, so camera
+ * changes made in between re-prioritize queue and drop tiles which are not needed anymore.
+ */
+void QGVLayerTilesOnline::scheduleLater()
+{
+    if (mSchedulePending) {
+        return;
+    }
+    mSchedulePending = true;
+    QMetaObject::invokeMethod(this, "onSchedule", Qt::QueuedConnection);
+}
+
+void QGVLayerTilesOnline::onSchedule()
+{
+    mSchedulePending = false;
+    if (mQueue.isEmpty() || mRequest.count() >= mMaxRequests) {
+        return;
+    }
+    std::stable_sort(mQueue.begin(), mQueue.end(), [this](quint64 left, quint64 right) {
+        return isHigherPriority(QGV::GeoTilePos::fromKey(left), QGV::GeoTilePos::fromKey(right));
+    });
+    auto it = mQueue.begin();
+    while (it != mQueue.end() && mRequest.count() < mMaxRequests) {
+        const auto tilePos = QGV::GeoTilePos::fromKey(*it);
+        const int mirror = freeMirror(tilePos, -1);
+        if (mirror < 0) {
+            ++it;
+            continue;
+        }
+        it = mQueue.erase(it);
+        sendRequest(tilePos, mirror);
+    }
+}
+
+/*!
+ * Mirror of tile if its host is not busy, otherwise next mirror with free host or -1.
+ */
+int QGVLayerTilesOnline::freeMirror(const QGV::GeoTilePos& tilePos, int excluded) const
+{
+    const int count = qMax(1, countMirrors());
+    for (int i = 0; i < count; ++i) {
+        const int mirror = (tileMirror(tilePos) + i) % count;
+        if (mirror == excluded) {
+            continue;
+        }
+        const QString host = QUrl(tilePosToMirrorUrl(tilePos, mirror)).host();
+        if (hostRequests.value(host) < maxRequestsPerHost) {
+            return mirror;
+        }
+    }
+    return -1;
+}
+
+/*!
+ * Revalidation of shown tiles goes after loading of new tiles. Visible tiles go first, then tiles
+ * of lower zoom level (they cover bigger area) and then tiles closer to view center.
+ */
+bool QGVLayerTilesOnline::isHigherPriority(const QGV::GeoTilePos& left, const QGV::GeoTilePos& right) const
+{
+    const bool leftRevalidating = mRevalidating.contains(left.toKey());
+    const bool rightRevalidating = mRevalidating.contains(right.toKey());
+    if (leftRevalidating != rightRevalidating) {
+        return rightRevalidating;
+    }
+    const bool leftVisible = isTileVisible(left);
+    const bool rightVisible = isTileVisible(right);
+    if (leftVisible != rightVisible) {
+        return leftVisible;
+    }
+    if (left.zoom() != right.zoom()) {
+        return left.zoom() < right.zoom();
+    }
+    return tileDistance(left) < tileDistance(right);
+}
+
+void QGVLayerTilesOnline::sendRequest(const QGV::GeoTilePos& tilePos, int mirror)
+{
+    const QUrl url(tilePosToMirrorUrl(tilePos, mirror));
     QNetworkRequest request(url);
     request.setRawHeader("User-Agent",
                          "Mozilla/5.0 (Windows; U; MSIE "
@@ -47,60 +367,247 @@ void QGVLayerTilesOnline::request(const QGV::GeoTilePos& tilePos)
                          "CLR 2.0.50727)");
     request.setAttribute(QNetworkRequest::HttpPipeliningAllowedAttribute, true);
     request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::PreferCache);
-    QNetworkReply* reply = QGV::getNetworkManager()->get(request);
-    reply->setProperty("TILE_OWNER", QVariant::fromValue(this));
-    reply->setProperty("TILE_REQUEST", true);
-    reply->setProperty("TILE_POS", QVariant::fromValue(tilePos));
-    mRequest[tilePos] = reply;
+    if (mRevalidating.contains(tilePos.toKey())) {
+        const auto validators = mValidators.value(tilePos.toKey());
+        if (!validators.first.isEmpty()) {
+            request.setRawHeader("If-None-Match", validators.first);
+        }
+        if (!validators.second.isEmpty()) {
+            request.setRawHeader("If-Modified-Since", validators.second);
+        }
+        request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::AlwaysNetwork);
+    }
+    const quint64 ticket = tileFetcher()->fetch(request, [this, tilePos, mirror](const QGVTileFetcher::Reply& reply) {
+        onReplyFinished(tilePos, mirror, reply);
+    });
+    hostRequests[url.host()]++;
+    mStatistics.requests++;
+    mRequest[tilePos].append({ ticket, mirror, url.host(), mClock.elapsed() });
     qgvDebug() << "request" << url;
+    if (mRequest[tilePos].size() == 1) {
+        scheduleHedge(tilePos);
+    }
 }
 
-void QGVLayerTilesOnline::cancel(const QGV::GeoTilePos& tilePos)
+void QGVLayerTilesOnline::scheduleHedge(const QGV::GeoTilePos& tilePos)
 {
-    removeReply(tilePos);
+    if (qFuzzyIsNull(mHedgeQuantile) || countMirrors() < 2 || mLatencies.size() < minLatencySamples) {
+        return;
+    }
+    QVector<int> latencies = mLatencies;
+    const int index = qMin(latencies.size() - 1, static_cast<int>(latencies.size() * mHedgeQuantile));
+    std::nth_element(latencies.begin(), latencies.begin() + index, latencies.end());
+    const quint64 ticket = mRequest.value(tilePos).first().ticket;
+    QTimer::singleShot(latencies.at(index), this, [this, tilePos, ticket]() { onHedge(tilePos, ticket); });
 }
 
-void QGVLayerTilesOnline::onReplyFinished(QNetworkReply* reply)
+void QGVLayerTilesOnline::onHedge(const QGV::GeoTilePos& tilePos, quint64 ticket)
 {
-    const auto tileRequest = reply->property("TILE_REQUEST").toBool();
-    if (!tileRequest) {
+    const QList<Request> requests = mRequest.value(tilePos);
+    if (requests.size() != 1 || requests.first().ticket != ticket) {
+        return;
+    }
+    const int mirror = freeMirror(tilePos, requests.first().mirror);
+    if (mirror < 0) {
         return;
     }
-    const auto tileOwner = reply->property("TILE_OWNER").value<QGVLayerTilesOnline*>();
-    if (tileOwner != this) {
+    qgvDebug() << "hedge" << tilePos << "to mirror" << mirror;
+    mStatistics.hedged++;
+    sendRequest(tilePos, mirror);
+}
+
+void QGVLayerTilesOnline::addLatency(int msLatency)
+{
+    if (mLatencies.size() < maxLatencySamples) {
+        mLatencies.append(msLatency);
         return;
     }
-    const auto tilePos = reply->property("TILE_POS").value<QGV::GeoTilePos>();
+    mLatencies[mLatencyIndex] = msLatency;
+    mLatencyIndex = (mLatencyIndex + 1) % maxLatencySamples;
+}
 
-    if (reply->error() != QNetworkReply::NoError) {
-        if (reply->error() != QNetworkReply::OperationCanceledError) {
-            qgvCritical() << "ERROR" << reply->errorString();
+void QGVLayerTilesOnline::onReplyFinished(const QGV::GeoTilePos& tilePos,
+                                          int mirror,
+                                          const QGVTileFetcher::Reply& reply)
+{
+    const bool failed = (reply.error != QNetworkReply::NoError && reply.error != QNetworkReply::ContentNotFoundError);
+    if (failed && mRequest.value(tilePos).size() > 1) {
+        removeReply(tilePos, mirror);
+        return;
+    }
+    for (const Request& request : mRequest.value(tilePos)) {
+        if (request.mirror == mirror && !failed) {
+            addLatency(static_cast<int>(mClock.elapsed() - request.sent));
         }
+    }
+    if (mRevalidating.contains(tilePos.toKey())) {
+        onRevalidated(tilePos, reply);
+        return;
+    }
+    if (reply.error == QNetworkReply::ContentNotFoundError) {
+        removeReply(tilePos);
+        mFailures.remove(tilePos.toKey());
+        mStatistics.missing++;
+        onTileMissing(tilePos);
+        return;
+    }
+    if (reply.error != QNetworkReply::NoError) {
         removeReply(tilePos);
+        if (reply.error != QNetworkReply::OperationCanceledError) {
+            onFailure(tilePos, reply.errorString);
+        }
         return;
     }
-    const auto rawImage = reply->readAll();
-    auto tile = new QGVImage();
-    tile->setGeometry(tilePos.toGeoRect());
-    tile->loadImage(rawImage);
+    const auto& rawImage = reply.data;
+    const auto url = reply.url.toString();
+    removeReply(tilePos);
+    mFailures.remove(tilePos.toKey());
+    if (rawImage.isEmpty()) {
+        mStatistics.missing++;
+        onTileMissing(tilePos);
+        return;
+    }
+    mStatistics.succeeded++;
+    if (getTileTtl() > 0 && (!reply.eTag.isEmpty() || !reply.lastModified.isEmpty())) {
+        mValidators.insert(tilePos.toKey(), qMakePair(reply.eTag, reply.lastModified));
+    }
+    QGVTileStore* store = QGV::getTileStore();
+    if (store != nullptr && getTileTtl() == 0) {
+        store->insert(getTileSource(), tilePos, rawImage);
+    }
+    decodeTile(tilePos, url, rawImage);
+}
+
+/*!
+ * Unchanged tile (304) keeps its image untouched. Failed revalidation keeps stale tile until next
+ * time to live, new content replaces tile in place.
+ */
+void QGVLayerTilesOnline::onRevalidated(const QGV::GeoTilePos& tilePos, const QGVTileFetcher::Reply& reply)
+{
+    removeReply(tilePos);
+    if (reply.error != QNetworkReply::NoError || reply.status == 304 || reply.data.isEmpty()) {
+        qgvDebug() << "revalidated" << tilePos << reply.status;
+        mRevalidating.remove(tilePos.toKey());
+        onTileValid(tilePos);
+        return;
+    }
+    mStatistics.succeeded++;
+    if (!reply.eTag.isEmpty() || !reply.lastModified.isEmpty()) {
+        mValidators.insert(tilePos.toKey(), qMakePair(reply.eTag, reply.lastModified));
+    }
+    decodeTile(tilePos, reply.url.toString(), reply.data);
+}
+
+/*!
+ * Failed tile is requested again after exponential backoff with jitter, so many tiles failed at
+ * once don't retry at once. When retries are exhausted tile is considered missing for failure
+ * timeout and is not requested during it.
+ */
+void QGVLayerTilesOnline::onFailure(const QGV::GeoTilePos& tilePos, const QString& error)
+{
+    static std::default_random_engine random(std::random_device{}());
+    const quint64 tileKey = tilePos.toKey();
+    const int attempt = ++mFailures[tileKey];
+    mStatistics.failed++;
+    if (attempt > mMaxRetries) {
+        qgvCritical() << "ERROR" << error << "for" << tilePos << "after" << attempt << "attempts";
+        mFailures.remove(tileKey);
+        mStatistics.rejected++;
+        onTileMissing(tilePos, mFailureTimeout);
+        return;
+    }
+    const qint64 backoff = qMin<qint64>(msMaxRetryDelay, static_cast<qint64>(mRetryDelay) << qMin(attempt - 1, 16));
+    const int delay = static_cast<int>(backoff * std::uniform_real_distribution<double>(0.5, 1.5)(random));
+    qgvDebug() << "retry" << tilePos << "in" << delay << "ms," << error;
+    mRetrying.insert(tileKey);
+    QTimer::singleShot(delay, this, [this, tileKey]() { onRetry(tileKey); });
+}
+
+void QGVLayerTilesOnline::onRetry(quint64 tileKey)
+{
+    if (!mRetrying.remove(tileKey)) {
+        return;
+    }
+    mStatistics.retries++;
+    mQueue.append(tileKey);
+    scheduleLater();
+}
+
+void QGVLayerTilesOnline::decodeTile(const QGV::GeoTilePos& tilePos, const QString& url, const QByteArray& rawImage)
+{
+    removeDecoding(tilePos);
+    if (isCompressedTiles()) {
+        onTileDecoded(tilePos, url, createEncodedTile(tilePos, rawImage));
+        return;
+    }
+    mDecoding[tilePos] = getTileWorker()->run(
+            [rawImage](const QAtomicInt& /*canceled*/) { return QGVTileWorker::decode(rawImage); },
+            [this, tilePos, url](const QImage& image) {
+                mDecoding.remove(tilePos);
+                onTileDecoded(tilePos, url, createTile(tilePos, image));
+            });
+}
+
+void QGVLayerTilesOnline::onTileDecoded(const QGV::GeoTilePos& tilePos, const QString& url, QGVDrawItem* tile)
+{
     tile->setProperty("drawDebug",
                       QString("%1\ntile(%2,%3,%4)")
-                              .arg(reply->url().toString())
+                              .arg(url)
                               .arg(tilePos.zoom())
                               .arg(tilePos.pos().x())
                               .arg(tilePos.pos().y()));
-    removeReply(tilePos);
+    if (mRevalidating.remove(tilePos.toKey())) {
+        onTileRefresh(tilePos, tile);
+        return;
+    }
     onTile(tilePos, tile);
 }
 
 void QGVLayerTilesOnline::removeReply(const QGV::GeoTilePos& tilePos)
 {
-    QNetworkReply* reply = mRequest.value(tilePos, nullptr);
-    if (reply == nullptr) {
+    if (!mRequest.contains(tilePos)) {
+        return;
+    }
+    for (const Request& request : mRequest.take(tilePos)) {
+        if (--hostRequests[request.host] <= 0) {
+            hostRequests.remove(request.host);
+        }
+        tileFetcher()->cancel(request.ticket);
+    }
+    for (QGVLayerTilesOnline* layer : onlineLayers) {
+        layer->scheduleLater();
+    }
+}
+
+/*!
+ * Removes one of hedged requests of tile, other requests are still waited for.
+ */
+void QGVLayerTilesOnline::removeReply(const QGV::GeoTilePos& tilePos, int mirror)
+{
+    QList<Request>& requests = mRequest[tilePos];
+    for (int i = 0; i < requests.size(); ++i) {
+        if (requests.at(i).mirror != mirror) {
+            continue;
+        }
+        const Request request = requests.takeAt(i);
+        if (--hostRequests[request.host] <= 0) {
+            hostRequests.remove(request.host);
+        }
+        tileFetcher()->cancel(request.ticket);
+        break;
+    }
+    if (requests.isEmpty()) {
+        mRequest.remove(tilePos);
+    }
+    for (QGVLayerTilesOnline* layer : onlineLayers) {
+        layer->scheduleLater();
+    }
+}
+
+void QGVLayerTilesOnline::removeDecoding(const QGV::GeoTilePos& tilePos)
+{
+    if (!mDecoding.contains(tilePos)) {
         return;
     }
-    mRequest.remove(tilePos);
-    reply->abort();
-    reply->close();
-    reply->deleteLater();
+    getTileWorker()->cancel(mDecoding.take(tilePos));
 }
@@ -350,6 +350,14 @@ void QGVMap::onMapCamera(const QGVCameraState& oldState, const QGVCameraState& n
     }
 }
 
+/*!
+ * Camera states planned by started animation (destination first), empty list when animation is finished.
+ */
+void QGVMap::onMapCameraPlan(const QList<QGVCameraState>& states)
+{
+    Q_EMIT cameraPlanned(states);
+}
+
 void QGVMap::mouseMoveEvent(QMouseEvent* event)
 {
     if (hasMouseTracking()) {
@@ -0,0 +1,226 @@
+/***************************************************************************
+ * QGeoView is a Qt / C ++ widget for visualizing geographic data.
+ * Copyright (C) 2018-2020 Andrey Yaroshenko.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see https://www.gnu.org/licenses.
+ ****************************************************************************/
+
+#include "QGVTileArchive.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QMap>
+#include <QtEndian>
+
+#include <cstring>
+#include <limits>
+
+namespace {
+const char magic[] = "QGVTILE1";
+const int magicSize = 8;
+const int headerSize = 32;
+const int entrySize = 24;
+}
+
+QGVTileArchive::QGVTileArchive(const QString& fileName)
+    : mFile(fileName)
+    , mData(nullptr)
+    , mDirectory(nullptr)
+    , mSize(0)
+    , mCount(0)
+{
+    open();
+}
+
+QGVTileArchive::~QGVTileArchive()
+{
+    if (mData != nullptr) {
+        mFile.unmap(const_cast<uchar*>(mData));
+    }
+}
+
+bool QGVTileArchive::isOpen() const
+{
+    return mData != nullptr;
+}
+
+QString QGVTileArchive::getFileName() const
+{
+    return mFile.fileName();
+}
+
+int QGVTileArchive::count() const
+{
+    return mCount;
+}
+
+int QGVTileArchive::minZoomlevel() const
+{
+    if (mCount == 0) {
+        return 0;
+    }
+    return QGV::GeoTilePos::fromKey(entryKey(0)).zoom();
+}
+
+int QGVTileArchive::maxZoomlevel() const
+{
+    if (mCount == 0) {
+        return -1;
+    }
+    return QGV::GeoTilePos::fromKey(entryKey(mCount - 1)).zoom();
+}
+
+bool QGVTileArchive::contains(const QGV::GeoTilePos& tilePos) const
+{
+    return findEntry(tilePos.toKey()) != nullptr;
+}
+
+QByteArray QGVTileArchive::find(const QGV::GeoTilePos& tilePos) const
+{
+    const uchar* entry = findEntry(tilePos.toKey());
+    if (entry == nullptr) {
+        return {};
+    }
+    const quint64 offset = qFromLittleEndian<quint64>(entry + 8);
+    const quint64 size = qFromLittleEndian<quint64>(entry + 16);
+    return QByteArray::fromRawData(reinterpret_cast<const char*>(mData + offset), static_cast<int>(size));
+}
+
+/*!
+ * Packs directory tree of tiles "<z>/<x>/<y>.<ext>" into archive file.
+ */
+bool QGVTileArchive::pack(const QString& directory, const QString& fileName)
+{
+    const QDir root(directory);
+    QMap<quint64, QString> tiles;
+    QDirIterator it(directory, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        const QStringList parts = root.relativeFilePath(it.next()).split('/');
+        if (parts.size() != 3) {
+            continue;
+        }
+        bool zOk = false;
+        bool xOk = false;
+        bool yOk = false;
+        const int z = parts[0].toInt(&zOk);
+        const int x = parts[1].toInt(&xOk);
+        const int y = parts[2].section('.', 0, 0).toInt(&yOk);
+        if (!zOk || !xOk || !yOk || z < 0 || z > 29 || x < 0 || y < 0 || x >= (1 << z) || y >= (1 << z)) {
+            continue;
+        }
+        tiles.insert(QGV::GeoTilePos(z, QPoint(x, y)).toKey(), it.filePath());
+    }
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qgvCritical() << "ERROR can't create tile archive" << fileName << file.errorString();
+        return false;
+    }
+    QByteArray directoryData;
+    directoryData.reserve(tiles.size() * entrySize);
+    file.write(QByteArray(headerSize, '\0'));
+    for (auto tile = tiles.constBegin(); tile != tiles.constEnd(); ++tile) {
+        QFile tileFile(tile.value());
+        if (!tileFile.open(QIODevice::ReadOnly)) {
+            qgvCritical() << "ERROR can't read tile" << tile.value() << tileFile.errorString();
+            return false;
+        }
+        const QByteArray blob = tileFile.readAll();
+        uchar entry[entrySize];
+        qToLittleEndian<quint64>(tile.key(), entry);
+        qToLittleEndian<quint64>(static_cast<quint64>(file.pos()), entry + 8);
+        qToLittleEndian<quint64>(static_cast<quint64>(blob.size()), entry + 16);
+        directoryData.append(reinterpret_cast<const char*>(entry), entrySize);
+        if (file.write(blob) != blob.size()) {
+            qgvCritical() << "ERROR can't write tile archive" << fileName << file.errorString();
+            return false;
+        }
+    }
+    uchar header[headerSize] = {};
+    std::memcpy(header, magic, magicSize);
+    qToLittleEndian<quint64>(static_cast<quint64>(tiles.size()), header + 8);
+    qToLittleEndian<quint64>(static_cast<quint64>(file.pos()), header + 16);
+    if (file.write(directoryData) != directoryData.size() || !file.seek(0) ||
+        file.write(reinterpret_cast<const char*>(header), headerSize) != headerSize) {
+        qgvCritical() << "ERROR can't write tile archive" << fileName << file.errorString();
+        return false;
+    }
+    qgvDebug() << "tile archive" << fileName << "packed with" << tiles.size() << "tiles";
+    return true;
+}
+
+void QGVTileArchive::open()
+{
+    if (!mFile.open(QIODevice::ReadOnly)) {
+        qgvCritical() << "ERROR can't open tile archive" << mFile.fileName() << mFile.errorString();
+        return;
+    }
+    const qint64 fileSize = mFile.size();
+    if (fileSize < headerSize) {
+        qgvCritical() << "ERROR invalid tile archive" << mFile.fileName();
+        return;
+    }
+    const uchar* data = mFile.map(0, fileSize);
+    if (data == nullptr) {
+        qgvCritical() << "ERROR can't map tile archive" << mFile.fileName() << mFile.errorString();
+        return;
+    }
+    const quint64 count = qFromLittleEndian<quint64>(data + 8);
+    const quint64 directoryOffset = qFromLittleEndian<quint64>(data + 16);
+    const quint64 maxCount = static_cast<quint64>(std::numeric_limits<int>::max());
+    const bool isValid = std::memcmp(data, magic, magicSize) == 0 && count <= maxCount &&
+                         directoryOffset >= static_cast<quint64>(headerSize) &&
+                         directoryOffset <= static_cast<quint64>(fileSize) &&
+                         count <= (static_cast<quint64>(fileSize) - directoryOffset) / entrySize;
+    if (!isValid) {
+        qgvCritical() << "ERROR invalid tile archive" << mFile.fileName();
+        mFile.unmap(const_cast<uchar*>(data));
+        return;
+    }
+    mData = data;
+    mSize = fileSize;
+    mDirectory = data + directoryOffset;
+    mCount = static_cast<int>(count);
+    qgvDebug() << "tile archive" << mFile.fileName() << "opened with" << mCount << "tiles";
+}
+
+const uchar* QGVTileArchive::findEntry(quint64 tileKey) const
+{
+    int from = 0;
+    int to = mCount;
+    while (from < to) {
+        const int middle = from + (to - from) / 2;
+        if (entryKey(middle) < tileKey) {
+            from = middle + 1;
+        } else {
+            to = middle;
+        }
+    }
+    if (from == mCount || entryKey(from) != tileKey) {
+        return nullptr;
+    }
+    const uchar* entry = mDirectory + static_cast<qint64>(from) * entrySize;
+    const quint64 offset = qFromLittleEndian<quint64>(entry + 8);
+    const quint64 size = qFromLittleEndian<quint64>(entry + 16);
+    if (offset > static_cast<quint64>(mSize) || size > static_cast<quint64>(mSize) - offset ||
+        size > static_cast<quint64>(std::numeric_limits<int>::max())) {
+        return nullptr;
+    }
+    return entry;
+}
+
+quint64 QGVTileArchive::entryKey(int index) const
+{
+    return qFromLittleEndian<quint64>(mDirectory + static_cast<qint64>(index) * entrySize);
+}
@@ -0,0 +1,128 @@
+/***************************************************************************
+ * QGeoView is a Qt / C ++ widget for visualizing geographic data.
+ * Copyright (C) 2018-2020 Andrey Yaroshenko.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see https://www.gnu.org/licenses.
+ ****************************************************************************/
+
+#include "QGVTileCache.h"
+
+#include <limits>
+
+namespace {
+const qint64 bytesPerCost = 1024;
+const qint64 sharedMaxBytes = 64 * 1024 * 1024;
+
+int bytesToCost(qint64 bytes)
+{
+    return static_cast<int>(qMin<qint64>(bytes / bytesPerCost, std::numeric_limits<int>::max()));
+}
+
+int imageCost(const QImage& image)
+{
+    return qMax(1, bytesToCost(static_cast<qint64>(image.bytesPerLine()) * image.height()));
+}
+}
+
+QGVTileCache::QGVTileCache(qint64 maxBytes)
+{
+    setMaxBytes(maxBytes);
+}
+
+void QGVTileCache::setMaxBytes(qint64 bytes)
+{
+    mCache.setMaxCost(bytesToCost(qMax<qint64>(0, bytes)));
+}
+
+qint64 QGVTileCache::getMaxBytes() const
+{
+    return mCache.maxCost() * bytesPerCost;
+}
+
+qint64 QGVTileCache::getBytes() const
+{
+    return mCache.totalCost() * bytesPerCost;
+}
+
+int QGVTileCache::count() const
+{
+    return mCache.count();
+}
+
+void QGVTileCache::insert(const QString& source, const QGV::GeoTilePos& tilePos, const QImage& image)
+{
+    if (image.isNull()) {
+        return;
+    }
+    mCache.insert(Key(source, tilePos.toKey()), new Entry{ image, QByteArray() }, imageCost(image));
+}
+
+void QGVTileCache::insertEncoded(const QString& source, const QGV::GeoTilePos& tilePos, const QByteArray& rawData)
+{
+    if (rawData.isEmpty()) {
+        return;
+    }
+    mCache.insert(Key(source, tilePos.toKey()), new Entry{ QImage(), rawData }, qMax(1, bytesToCost(rawData.size())));
+}
+
+/*!
+ * Decoded image of tile, null image if tile is missing or is kept encoded (see findEncoded).
+ */
+QImage QGVTileCache::find(const QString& source, const QGV::GeoTilePos& tilePos)
+{
+    const Entry* entry = mCache.object(Key(source, tilePos.toKey()));
+    return (entry != nullptr) ? entry->image : QImage();
+}
+
+QByteArray QGVTileCache::findEncoded(const QString& source, const QGV::GeoTilePos& tilePos)
+{
+    const Entry* entry = mCache.object(Key(source, tilePos.toKey()));
+    return (entry != nullptr) ? entry->encoded : QByteArray();
+}
+
+bool QGVTileCache::contains(const QString& source, const QGV::GeoTilePos& tilePos) const
+{
+    return mCache.contains(Key(source, tilePos.toKey()));
+}
+
+void QGVTileCache::remove(const QString& source, const QGV::GeoTilePos& tilePos)
+{
+    mCache.remove(Key(source, tilePos.toKey()));
+}
+
+void QGVTileCache::clear()
+{
+    mCache.clear();
+}
+
+/*!
+ * Drops least recently used tiles until cache uses not more than given amount of bytes.
+ * Intended to be called by application under memory pressure, budget is not changed.
+ */
+void QGVTileCache::trim(qint64 bytes)
+{
+    const int maxCost = mCache.maxCost();
+    mCache.setMaxCost(bytesToCost(qMax<qint64>(0, bytes)));
+    mCache.setMaxCost(maxCost);
+}
+
+/*!
+ * Process-wide cache, default cache of tile layers. Layers of same tile source on different maps
+ * share decoded images through it.
+ */
+QSharedPointer<QGVTileCache> QGVTileCache::shared()
+{
+    static QSharedPointer<QGVTileCache> cache(new QGVTileCache(sharedMaxBytes));
+    return cache;
+}
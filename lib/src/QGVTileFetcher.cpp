@@ -0,0 +1,146 @@
+/***************************************************************************
+ * QGeoView is a Qt / C ++ widget for visualizing geographic data.
+ * Copyright (C) 2018-2020 Andrey Yaroshenko.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see https://www.gnu.org/licenses.
+ ****************************************************************************/
+
+#include "QGVTileFetcher.h"
+
+#include <QNetworkAccessManager>
+#include <QNetworkDiskCache>
+#include <QTimer>
+
+struct QGVTileFetcherTask
+{
+    QNetworkRequest request;
+    QGVTileFetcher::Callback callback;
+    QAtomicInt canceled;
+    QNetworkReply* reply;
+    QGVTileFetcher::Reply result;
+};
+
+/*!
+ * Session object, network access manager and replies live in network thread and are accessed only
+ * from code executed in it. Tasks are shared, result of task is passed back by queued call.
+ */
+QGVTileFetcher::QGVTileFetcher(QObject* parent)
+    : QObject(parent)
+    , mSession(new QObject())
+    , mManager(nullptr)
+    , mLastTicket(0)
+{
+    mThread.setObjectName("QGVTileFetcher");
+    mSession->moveToThread(&mThread);
+    connect(&mThread, &QThread::finished, mSession, &QObject::deleteLater);
+    mThread.start();
+}
+
+QGVTileFetcher::~QGVTileFetcher()
+{
+    cancelAll();
+    mThread.quit();
+    mThread.wait();
+}
+
+/*!
+ * Enables disk cache of network replies, 0 keeps default maximum size of cache.
+ */
+void QGVTileFetcher::setCacheDirectory(const QString& path, qint64 maxBytes)
+{
+    QTimer::singleShot(0, mSession, [this, path, maxBytes]() {
+        auto cache = new QNetworkDiskCache();
+        cache->setCacheDirectory(path);
+        if (maxBytes > 0) {
+            cache->setMaximumCacheSize(maxBytes);
+        }
+        manager()->setCache(cache);
+    });
+}
+
+int QGVTileFetcher::countRequests() const
+{
+    return mTasks.count();
+}
+
+quint64 QGVTileFetcher::fetch(const QNetworkRequest& request, const Callback& callback)
+{
+    const quint64 ticket = ++mLastTicket;
+    QSharedPointer<QGVTileFetcherTask> task(new QGVTileFetcherTask());
+    task->request = request;
+    task->callback = callback;
+    task->reply = nullptr;
+    mTasks.insert(ticket, task);
+    QTimer::singleShot(0, mSession, [this, ticket, task]() { start(ticket, task); });
+    return ticket;
+}
+
+void QGVTileFetcher::cancel(quint64 ticket)
+{
+    const auto task = mTasks.take(ticket);
+    if (task.isNull()) {
+        return;
+    }
+    task->canceled.store(1);
+    QTimer::singleShot(0, mSession, [task]() {
+        if (task->reply != nullptr) {
+            task->reply->abort();
+        }
+    });
+}
+
+void QGVTileFetcher::cancelAll()
+{
+    for (quint64 ticket : mTasks.keys()) {
+        cancel(ticket);
+    }
+}
+
+void QGVTileFetcher::onFetchFinished(quint64 ticket)
+{
+    const auto task = mTasks.take(ticket);
+    if (task.isNull() || task->canceled.load() != 0) {
+        return;
+    }
+    task->callback(task->result);
+}
+
+QNetworkAccessManager* QGVTileFetcher::manager()
+{
+    if (mManager == nullptr) {
+        mManager = new QNetworkAccessManager(mSession);
+    }
+    return mManager;
+}
+
+void QGVTileFetcher::start(quint64 ticket, const QSharedPointer<QGVTileFetcherTask>& task)
+{
+    if (task->canceled.load() != 0) {
+        return;
+    }
+    task->reply = manager()->get(task->request);
+    connect(task->reply, &QNetworkReply::finished, mSession, [this, ticket, task]() {
+        QNetworkReply* reply = task->reply;
+        task->reply = nullptr;
+        task->result.url = reply->url();
+        task->result.error = reply->error();
+        task->result.errorString = reply->errorString();
+        task->result.status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        task->result.eTag = reply->rawHeader("ETag");
+        task->result.lastModified = reply->rawHeader("Last-Modified");
+        task->result.data = reply->readAll();
+        reply->deleteLater();
+        QMetaObject::invokeMethod(this, "onFetchFinished", Qt::QueuedConnection, Q_ARG(quint64, ticket));
+    });
+}
@@ -0,0 +1,197 @@
+/***************************************************************************
+ * QGeoView is a Qt / C ++ widget for visualizing geographic data.
+ * Copyright (C) 2018-2020 Andrey Yaroshenko.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see https://www.gnu.org/licenses.
+ ****************************************************************************/
+
+#include "QGVTileIndex.h"
+
+namespace {
+const int maxTileZoom = 29;
+
+quint64 zoomBaseKey(int zoom)
+{
+    return QGV::GeoTilePos(zoom, QPoint(0, 0)).toKey();
+}
+
+/*!
+ * Range of keys [fromKey, toKey) of all descendants of root tile at given zoom level.
+ */
+void spanKeys(quint64 rootKey, int zoom, quint64& fromKey, quint64& toKey)
+{
+    const int rootZoom = QGV::GeoTilePos::fromKey(rootKey).zoom();
+    const int shift = 2 * (zoom - rootZoom);
+    const quint64 morton = rootKey - zoomBaseKey(rootZoom);
+    fromKey = zoomBaseKey(zoom) + (morton << shift);
+    toKey = zoomBaseKey(zoom) + ((morton + 1) << shift);
+}
+}
+
+QGVTileIndex::Iterator::Iterator()
+    : mIndex(nullptr)
+    , mRootKey(0)
+    , mZoom(0)
+    , mLastZoom(-1)
+    , mKey(0)
+    , mToKey(0)
+{}
+
+QGVTileIndex::Iterator::Iterator(const QGVTileIndex* index, quint64 rootKey, int fromZoom, int toZoom)
+    : mIndex(index)
+    , mRootKey(rootKey)
+    , mZoom(fromZoom)
+    , mLastZoom(toZoom)
+    , mKey(0)
+    , mToKey(0)
+{
+    if (mZoom > mLastZoom || mIndex->mTiles.isEmpty()) {
+        mIndex = nullptr;
+        return;
+    }
+    quint64 fromKey = 0;
+    spanKeys(mRootKey, mZoom, fromKey, mToKey);
+    seek(fromKey);
+}
+
+QGV::GeoTilePos QGVTileIndex::Iterator::operator*() const
+{
+    return QGV::GeoTilePos::fromKey(mKey);
+}
+
+QGVTileIndex::Iterator& QGVTileIndex::Iterator::operator++()
+{
+    if (mIndex != nullptr) {
+        seek(mKey + 1);
+    }
+    return *this;
+}
+
+bool QGVTileIndex::Iterator::operator!=(const Iterator& other) const
+{
+    return mIndex != other.mIndex || (mIndex != nullptr && mKey != other.mKey);
+}
+
+void QGVTileIndex::Iterator::seek(quint64 fromKey)
+{
+    while (true) {
+        const auto it = mIndex->mTiles.lowerBound(fromKey);
+        if (it != mIndex->mTiles.constEnd() && it.key() < mToKey) {
+            mKey = it.key();
+            return;
+        }
+        if (++mZoom > mLastZoom) {
+            mIndex = nullptr;
+            return;
+        }
+        spanKeys(mRootKey, mZoom, fromKey, mToKey);
+    }
+}
+
+QGVTileIndex::Range::Range(const QGVTileIndex* index, quint64 rootKey, int fromZoom, int toZoom)
+    : mIndex(index)
+    , mRootKey(rootKey)
+    , mFromZoom(fromZoom)
+    , mToZoom(toZoom)
+{}
+
+QGVTileIndex::Iterator QGVTileIndex::Range::begin() const
+{
+    return Iterator(mIndex, mRootKey, mFromZoom, mToZoom);
+}
+
+QGVTileIndex::Iterator QGVTileIndex::Range::end() const
+{
+    return Iterator();
+}
+
+QGVTileIndex::QGVTileIndex()
+{}
+
+void QGVTileIndex::insert(const QGV::GeoTilePos& tilePos, QGVDrawItem* tile)
+{
+    mTiles[tilePos.toKey()] = tile;
+}
+
+QGVDrawItem* QGVTileIndex::take(const QGV::GeoTilePos& tilePos)
+{
+    return mTiles.take(tilePos.toKey());
+}
+
+QGVDrawItem* QGVTileIndex::value(const QGV::GeoTilePos& tilePos) const
+{
+    return mTiles.value(tilePos.toKey(), nullptr);
+}
+
+bool QGVTileIndex::contains(const QGV::GeoTilePos& tilePos) const
+{
+    return mTiles.contains(tilePos.toKey());
+}
+
+bool QGVTileIndex::isFinished(const QGV::GeoTilePos& tilePos) const
+{
+    return value(tilePos) != nullptr;
+}
+
+bool QGVTileIndex::isEmpty() const
+{
+    return mTiles.isEmpty();
+}
+
+int QGVTileIndex::count() const
+{
+    return mTiles.count();
+}
+
+void QGVTileIndex::clear()
+{
+    mTiles.clear();
+}
+
+QGVTileIndex::Range QGVTileIndex::tiles(int zoom) const
+{
+    if (zoom < 0 || zoom > maxTileZoom) {
+        return Range(this, 0, 0, -1);
+    }
+    return Range(this, zoomBaseKey(0), zoom, zoom);
+}
+
+QList<QGV::GeoTilePos> QGVTileIndex::ancestors(const QGV::GeoTilePos& tilePos) const
+{
+    QList<QGV::GeoTilePos> result;
+    for (int zoom = tilePos.zoom() - 1; zoom >= 0; --zoom) {
+        const QGV::GeoTilePos parent = tilePos.parent(zoom);
+        if (contains(parent)) {
+            result.append(parent);
+        }
+    }
+    return result;
+}
+
+QGVTileIndex::Range QGVTileIndex::descendants(const QGV::GeoTilePos& tilePos) const
+{
+    if (mTiles.isEmpty()) {
+        return Range(this, 0, 0, -1);
+    }
+    const int lastZoom = QGV::GeoTilePos::fromKey(mTiles.lastKey()).zoom();
+    return Range(this, tilePos.toKey(), tilePos.zoom() + 1, lastZoom);
+}
+
+QGVTileIndex::Range QGVTileIndex::descendants(const QGV::GeoTilePos& tilePos, int zoom) const
+{
+    if (zoom <= tilePos.zoom() || zoom > maxTileZoom) {
+        return Range(this, 0, 0, -1);
+    }
+    return Range(this, tilePos.toKey(), zoom, zoom);
+}
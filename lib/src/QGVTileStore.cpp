@@ -0,0 +1,359 @@
+/***************************************************************************
+ * QGeoView is a Qt / C ++ widget for visualizing geographic data.
+ * Copyright (C) 2018-2020 Andrey Yaroshenko.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see https://www.gnu.org/licenses.
+ ****************************************************************************/
+
+#include "QGVTileStore.h"
+
+#include <QDir>
+#include <QtEndian>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+const char* packFileName = "tiles.pack";
+const char* indexFileName = "tiles.index";
+const char* compactSuffix = ".compact";
+const int recordSize = 32;
+const int flushInterval = 32;
+const double maxDeadRatio = 0.25;
+const double compactFullRatio = 0.95;
+const double compactTargetRatio = 0.75;
+const qint64 mapChunkSize = 16 * 1024 * 1024;
+
+void writeRecord(uchar* record, quint64 sourceId, quint64 tileKey, qint64 offset, qint64 size)
+{
+    qToLittleEndian<quint64>(sourceId, record);
+    qToLittleEndian<quint64>(tileKey, record + 8);
+    qToLittleEndian<quint64>(static_cast<quint64>(offset), record + 16);
+    qToLittleEndian<quint64>(static_cast<quint64>(size), record + 24);
+}
+}
+
+QGVTileStore::QGVTileStore(const QString& directory, qint64 maxBytes)
+    : mDirectory(directory)
+    , mMaxBytes(qMax<qint64>(0, maxBytes))
+    , mPackSize(0)
+    , mUnflushed(0)
+{
+    open();
+}
+
+QGVTileStore::~QGVTileStore()
+{
+    flush();
+    for (const auto& mapped : mMapped) {
+        mPack.unmap(mapped.first);
+    }
+    mMapped.clear();
+}
+
+bool QGVTileStore::isOpen() const
+{
+    return mPack.isOpen() && mIndex.isOpen();
+}
+
+QString QGVTileStore::getDirectory() const
+{
+    return mDirectory;
+}
+
+/*!
+ * Limit of pack file size, new tiles are not stored when it is reached. Store is compacted
+ * to fit into the limit on next open.
+ */
+void QGVTileStore::setMaxBytes(qint64 bytes)
+{
+    mMaxBytes = qMax<qint64>(0, bytes);
+}
+
+qint64 QGVTileStore::getMaxBytes() const
+{
+    return mMaxBytes;
+}
+
+int QGVTileStore::count() const
+{
+    return mEntries.count();
+}
+
+qint64 QGVTileStore::size() const
+{
+    return mPackSize;
+}
+
+bool QGVTileStore::contains(const QString& source, const QGV::GeoTilePos& tilePos) const
+{
+    return mEntries.contains(Key(sourceId(source), tilePos.toKey()));
+}
+
+/*!
+ * Returns copy of tile data, so it can be kept in tile cache or encoded tiles after store is gone.
+ */
+QByteArray QGVTileStore::find(const QString& source, const QGV::GeoTilePos& tilePos)
+{
+    const auto it = mEntries.constFind(Key(sourceId(source), tilePos.toKey()));
+    if (it == mEntries.constEnd()) {
+        return {};
+    }
+    QByteArray data(static_cast<int>(it->size), Qt::Uninitialized);
+    qint64 copied = 0;
+    while (copied < it->size) {
+        qint64 available = 0;
+        const uchar* chunk = mappedData(it->offset + copied, &available);
+        if (chunk == nullptr) {
+            return {};
+        }
+        const qint64 length = qMin(available, it->size - copied);
+        std::memcpy(data.data() + copied, chunk, static_cast<size_t>(length));
+        copied += length;
+    }
+    return data;
+}
+
+/*!
+ * Tile which is stored already is not written again. Files are flushed by batches of tiles,
+ * index of not flushed tiles is validated against pack file on next open.
+ */
+bool QGVTileStore::insert(const QString& source, const QGV::GeoTilePos& tilePos, const QByteArray& rawData)
+{
+    if (!isOpen() || rawData.isEmpty()) {
+        return false;
+    }
+    const Key key(sourceId(source), tilePos.toKey());
+    if (mEntries.contains(key)) {
+        return true;
+    }
+    if (mPackSize + rawData.size() > mMaxBytes) {
+        qgvDebug() << "tile store" << mDirectory << "is full";
+        return false;
+    }
+    const Entry entry = { mPackSize, rawData.size() };
+    if (mPack.write(rawData) != rawData.size()) {
+        qgvCritical() << "ERROR" << mPack.errorString();
+        return false;
+    }
+    mPackSize += entry.size;
+    uchar record[recordSize];
+    writeRecord(record, key.first, key.second, entry.offset, entry.size);
+    if (mIndex.write(reinterpret_cast<const char*>(record), recordSize) != recordSize) {
+        qgvCritical() << "ERROR" << mIndex.errorString();
+        return false;
+    }
+    mEntries.insert(key, entry);
+    if (++mUnflushed >= flushInterval) {
+        flush();
+    }
+    return true;
+}
+
+/*!
+ * Writes buffered tiles to files, pack file goes first so index never points to unwritten data.
+ */
+void QGVTileStore::flush()
+{
+    if (mUnflushed == 0) {
+        return;
+    }
+    mUnflushed = 0;
+    if (!mPack.flush()) {
+        qgvCritical() << "ERROR" << mPack.errorString();
+        return;
+    }
+    if (!mIndex.flush()) {
+        qgvCritical() << "ERROR" << mIndex.errorString();
+    }
+}
+
+/*!
+ * Stable 64-bit FNV-1a hash of source name, qHash is randomized per process and
+ * can't be stored.
+ */
+quint64 QGVTileStore::sourceId(const QString& source)
+{
+    quint64 hash = Q_UINT64_C(14695981039346656037);
+    for (const char byte : source.toUtf8()) {
+        hash ^= static_cast<uchar>(byte);
+        hash *= Q_UINT64_C(1099511628211);
+    }
+    return hash;
+}
+
+void QGVTileStore::open()
+{
+    if (!QDir().mkpath(mDirectory)) {
+        qgvCritical() << "ERROR can't create tile store" << mDirectory;
+        return;
+    }
+    const QDir dir(mDirectory);
+    mPack.setFileName(dir.filePath(packFileName));
+    mIndex.setFileName(dir.filePath(indexFileName));
+    if (!openFiles()) {
+        return;
+    }
+    loadIndex();
+    if (isCompactNeeded() && compact()) {
+        loadIndex();
+    }
+}
+
+bool QGVTileStore::openFiles()
+{
+    if (!mPack.open(QIODevice::ReadWrite | QIODevice::Append) ||
+        !mIndex.open(QIODevice::ReadWrite | QIODevice::Append)) {
+        qgvCritical() << "ERROR can't open tile store" << mDirectory;
+        mPack.close();
+        mIndex.close();
+        return false;
+    }
+    return true;
+}
+
+void QGVTileStore::loadIndex()
+{
+    mEntries.clear();
+    mPackSize = mPack.size();
+    const qint64 indexSize = mIndex.size() - mIndex.size() % recordSize;
+    if (mIndex.size() != indexSize) {
+        qgvWarning() << "truncated tile store index" << mIndex.fileName();
+        mIndex.resize(indexSize);
+    }
+    uchar* index = (indexSize > 0) ? mIndex.map(0, indexSize) : nullptr;
+    if (index == nullptr) {
+        return;
+    }
+    for (qint64 pos = 0; pos < indexSize; pos += recordSize) {
+        const uchar* record = index + pos;
+        const Key key(qFromLittleEndian<quint64>(record), qFromLittleEndian<quint64>(record + 8));
+        const Entry entry = { static_cast<qint64>(qFromLittleEndian<quint64>(record + 16)),
+                              static_cast<qint64>(qFromLittleEndian<quint64>(record + 24)) };
+        if (entry.offset < 0 || entry.size <= 0 || entry.offset + entry.size > mPackSize) {
+            continue;
+        }
+        mEntries.insert(key, entry);
+    }
+    mIndex.unmap(index);
+    qgvDebug() << "tile store" << mDirectory << "opened with" << mEntries.count() << "tiles";
+}
+
+/*!
+ * Store is compacted when pack file is (almost) full or has too much data of replaced tiles.
+ */
+bool QGVTileStore::isCompactNeeded() const
+{
+    qint64 liveBytes = 0;
+    for (const Entry& entry : mEntries) {
+        liveBytes += entry.size;
+    }
+    return mPackSize > mMaxBytes * compactFullRatio || liveBytes < mPackSize * (1.0 - maxDeadRatio);
+}
+
+/*!
+ * Copies live tiles to new files, newest tiles first until size target is reached (pack offset
+ * is insertion order), and replaces old files with them. Called on open only, before any data
+ * is mapped.
+ */
+bool QGVTileStore::compact()
+{
+    QVector<QPair<Key, Entry>> live;
+    for (auto it = mEntries.constBegin(); it != mEntries.constEnd(); ++it) {
+        live.append(qMakePair(it.key(), it.value()));
+    }
+    std::sort(live.begin(), live.end(), [](const QPair<Key, Entry>& left, const QPair<Key, Entry>& right) {
+        return left.second.offset > right.second.offset;
+    });
+    const qint64 targetBytes = static_cast<qint64>(mMaxBytes * compactTargetRatio);
+    qint64 keptBytes = 0;
+    int keptCount = 0;
+    for (const auto& tile : live) {
+        if (keptBytes + tile.second.size > targetBytes) {
+            break;
+        }
+        keptBytes += tile.second.size;
+        keptCount++;
+    }
+    qgvDebug() << "compact tile store" << mDirectory << "from" << mPackSize << "to" << keptBytes << "bytes";
+
+    uchar* pack = (mPackSize > 0) ? mPack.map(0, mPackSize) : nullptr;
+    if (pack == nullptr) {
+        qgvCritical() << "ERROR" << mPack.errorString();
+        return false;
+    }
+    QFile newPack(mPack.fileName() + compactSuffix);
+    QFile newIndex(mIndex.fileName() + compactSuffix);
+    bool succeeded = newPack.open(QIODevice::WriteOnly | QIODevice::Truncate) &&
+                     newIndex.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    qint64 offset = 0;
+    for (int i = keptCount - 1; i >= 0 && succeeded; --i) {
+        const Key& key = live[i].first;
+        const Entry& entry = live[i].second;
+        uchar record[recordSize];
+        writeRecord(record, key.first, key.second, offset, entry.size);
+        succeeded = newPack.write(reinterpret_cast<const char*>(pack + entry.offset), entry.size) == entry.size &&
+                    newIndex.write(reinterpret_cast<const char*>(record), recordSize) == recordSize;
+        offset += entry.size;
+    }
+    succeeded = succeeded && newPack.flush() && newIndex.flush();
+    mPack.unmap(pack);
+    newPack.close();
+    newIndex.close();
+    if (!succeeded) {
+        qgvCritical() << "ERROR can't compact tile store" << mDirectory;
+        newPack.remove();
+        newIndex.remove();
+        return false;
+    }
+    mPack.close();
+    mIndex.close();
+    if (!QFile::remove(mIndex.fileName()) || !QFile::remove(mPack.fileName()) ||
+        !QFile::rename(newPack.fileName(), mPack.fileName()) ||
+        !QFile::rename(newIndex.fileName(), mIndex.fileName())) {
+        qgvCritical() << "ERROR can't replace tile store" << mDirectory;
+    }
+    return openFiles();
+}
+
+/*!
+ * Pack file is mapped by aligned chunks of fixed size, so number of mappings is bounded by
+ * size limit. Only last chunk can be mapped partially, it is mapped again when pack has grown
+ * past it. Mapped data is copied by find() and is never referenced after it.
+ */
+const uchar* QGVTileStore::mappedData(qint64 offset, qint64* available)
+{
+    if (offset < 0 || offset >= mPackSize) {
+        return nullptr;
+    }
+    const qint64 start = offset - offset % mapChunkSize;
+    auto it = mMapped.find(start);
+    if (it != mMapped.end() && offset >= start + it.value().second) {
+        mPack.unmap(it.value().first);
+        mMapped.erase(it);
+        it = mMapped.end();
+    }
+    if (it == mMapped.end()) {
+        flush();
+        const qint64 size = qMin(start + mapChunkSize, mPackSize) - start;
+        uchar* data = mPack.map(start, size);
+        if (data == nullptr) {
+            qgvCritical() << "ERROR" << mPack.errorString();
+            return nullptr;
+        }
+        it = mMapped.insert(start, qMakePair(data, size));
+    }
+    *available = start + it.value().second - offset;
+    return it.value().first + (offset - start);
+}
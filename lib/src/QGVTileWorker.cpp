@@ -0,0 +1,194 @@
+/***************************************************************************
+ * QGeoView is a Qt / C ++ widget for visualizing geographic data.
+ * Copyright (C) 2018-2020 Andrey Yaroshenko.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see https://www.gnu.org/licenses.
+ ****************************************************************************/
+
+#include "QGVTileWorker.h"
+
+#include <QCoreApplication>
+#include <QPointer>
+#include <QRunnable>
+#include <QThread>
+
+struct QGVTileWorkerTask
+{
+    QGVTileWorker::Job job;
+    QGVTileWorker::Callback callback;
+    QAtomicInt canceled;
+    QImage result;
+};
+
+namespace {
+class TaskRunnable : public QRunnable
+{
+public:
+    TaskRunnable(QGVTileWorker* worker, quint64 ticket, const QSharedPointer<QGVTileWorkerTask>& task)
+        : mWorker(worker)
+        , mTicket(ticket)
+        , mTask(task)
+    {}
+
+    void run() override
+    {
+        if (mTask->canceled.load() == 0) {
+            mTask->result = mTask->job(mTask->canceled);
+        }
+        QMetaObject::invokeMethod(mWorker, "onJobFinished", Qt::QueuedConnection, Q_ARG(quint64, mTicket));
+    }
+
+private:
+    QGVTileWorker* mWorker;
+    quint64 mTicket;
+    QSharedPointer<QGVTileWorkerTask> mTask;
+};
+}
+
+QGVTileWorker::QGVTileWorker(QObject* parent)
+    : QObject(parent)
+    , mSubmitted(0)
+    , mLastTicket(0)
+{
+    mPool.setMaxThreadCount(qMax(1, QThread::idealThreadCount() / 2));
+    mMaxQueueDepth = mPool.maxThreadCount();
+}
+
+QGVTileWorker::~QGVTileWorker()
+{
+    cancelAll();
+    mPool.waitForDone();
+}
+
+void QGVTileWorker::setMaxThreads(int count)
+{
+    mPool.setMaxThreadCount(qMax(1, count));
+    dispatch();
+}
+
+int QGVTileWorker::getMaxThreads() const
+{
+    return mPool.maxThreadCount();
+}
+
+void QGVTileWorker::setMaxQueueDepth(int depth)
+{
+    mMaxQueueDepth = qMax(0, depth);
+    dispatch();
+}
+
+int QGVTileWorker::getMaxQueueDepth() const
+{
+    return mMaxQueueDepth;
+}
+
+int QGVTileWorker::countJobs() const
+{
+    return mTasks.count();
+}
+
+quint64 QGVTileWorker::run(const Job& job, const Callback& callback)
+{
+    const quint64 ticket = ++mLastTicket;
+    QSharedPointer<QGVTileWorkerTask> task(new QGVTileWorkerTask());
+    task->job = job;
+    task->callback = callback;
+    mTasks.insert(ticket, task);
+    mWaiting.append(ticket);
+    dispatch();
+    return ticket;
+}
+
+void QGVTileWorker::cancel(quint64 ticket)
+{
+    const auto task = mTasks.value(ticket);
+    if (task.isNull()) {
+        return;
+    }
+    task->canceled.store(1);
+    if (mWaiting.removeOne(ticket)) {
+        mTasks.remove(ticket);
+    }
+}
+
+void QGVTileWorker::cancelAll()
+{
+    for (const auto& task : mTasks) {
+        task->canceled.store(1);
+    }
+    for (quint64 ticket : mWaiting) {
+        mTasks.remove(ticket);
+    }
+    mWaiting.clear();
+}
+
+/*!
+ * Job is waiting in the worker and is not handed to the thread pool yet.
+ */
+bool QGVTileWorker::isWaiting(quint64 ticket) const
+{
+    return mWaiting.contains(ticket);
+}
+
+QImage QGVTileWorker::decode(const QByteArray& rawData)
+{
+    QImage image;
+    image.loadFromData(rawData);
+    return toDisplayFormat(image);
+}
+
+QImage QGVTileWorker::toDisplayFormat(const QImage& image)
+{
+    if (image.isNull()) {
+        return image;
+    }
+    const QImage::Format format = image.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32;
+    if (image.format() == format) {
+        return image;
+    }
+    return image.convertToFormat(format);
+}
+
+/*!
+ * Process-wide worker of tile layers and images, so number of threads doesn't grow with number
+ * of layers. Users of shared worker must cancel their jobs before they are destroyed.
+ */
+QGVTileWorker* QGVTileWorker::shared()
+{
+    static QPointer<QGVTileWorker> worker;
+    if (worker.isNull()) {
+        worker = new QGVTileWorker(QCoreApplication::instance());
+    }
+    return worker;
+}
+
+void QGVTileWorker::onJobFinished(quint64 ticket)
+{
+    mSubmitted--;
+    const auto task = mTasks.take(ticket);
+    dispatch();
+    if (task.isNull() || task->canceled.load() != 0) {
+        return;
+    }
+    task->callback(task->result);
+}
+
+void QGVTileWorker::dispatch()
+{
+    while (!mWaiting.isEmpty() && mSubmitted < mPool.maxThreadCount() + mMaxQueueDepth) {
+        const quint64 ticket = mWaiting.takeFirst();
+        mSubmitted++;
+        mPool.start(new TaskRunnable(this, ticket, mTasks.value(ticket)));
+    }
+}